@@ -1,17 +1,24 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <stdint.h>
+#include <stdarg.h>
+#include "../comun/indice.h"
+#include "../comun/lexico.h"
+#include "../comun/estadisticas.h"
+#include "../comun/flujo.h"
+#include "../comun/utf8.h"
 
 
-#define MAX_TOKENS 1000
-
+// Mismos valores que LxTipo (comun/lexico.h): el lexer comun devuelve
+// directamente estos tipos.
 typedef enum {
-    L_LLAVE, R_LLAVE, L_CORCHETE, R_CORCHETE,
-    COMA, DOS_PUNTOS,
-    STRING, NUMBER,
-    PR_TRUE, PR_FALSE, PR_NULL,
-    EOF_TOKEN, ERROR_TOKEN
+    L_LLAVE = LX_LLAVE_A, R_LLAVE = LX_LLAVE_C,
+    L_CORCHETE = LX_CORCHETE_A, R_CORCHETE = LX_CORCHETE_C,
+    COMA = LX_COMA, DOS_PUNTOS = LX_DOS_PUNTOS,
+    STRING = LX_CADENA, NUMBER = LX_NUMERO,
+    PR_TRUE = LX_TRUE, PR_FALSE = LX_FALSE, PR_NULL = LX_NULL,
+    EOF_TOKEN = LX_FIN, ERROR_TOKEN = LX_ERROR
 } TokenType;
 
 const char* token_names[] = {
@@ -20,86 +27,398 @@ const char* token_names[] = {
     "PR_TRUE", "PR_FALSE", "PR_NULL", "EOF", "ERROR_TOKEN"
 };
 
+// Flujo de tokens como estructura de arreglos (9 bytes por token): el
+// lexema no se copia, se guarda su posicion y largo dentro de `fuente`.
+// La linea no se guarda: sale de la posicion cuando hace falta (linea_de).
 typedef struct {
-    TokenType tipo;
-    char lexema[1024];
-    int linea;
-} Token;
+    unsigned char *tipo;   // TokenType en un byte
+    uint32_t *inicio;      // desplazamiento del lexema en fuente
+    uint32_t *largo;
+    size_t n, cap;
+} FlujoTokens;
+
+FlujoTokens tokens;
+size_t current = 0;
+
+// Texto fuente completo; los bloques se agregan a medida que se leen.
+char *fuente = NULL;
+size_t fuente_len = 0, fuente_cap = 0;
+
+static void *xrealloc(void *p, size_t n) {
+    EST(est_asignacion(n));
+    p = realloc(p, n);
+    if (!p) {
+        printf("Memoria insuficiente\n");
+        exit(1);
+    }
+    return p;
+}
+
+// Lexema del token i (no terminado en '\0')
+static inline const char *lexema(size_t i, size_t *largo) {
+    *largo = tokens.largo[i];
+    return fuente + tokens.inicio[i];
+}
 
-Token tokens[MAX_TOKENS];
-int token_index = 0, current = 0;
+// Modo --stream: documentos concatenados o NDJSON. El lexer cierra cada
+// documento con un EOF_TOKEN cuando la profundidad vuelve a 0.
+int modo_stream = 0;
+int profundidad = 0;
 
 // ==================== ANALIZADOR LÉXICO ====================
 
-void agregar_token(TokenType tipo, const char* lexema, int linea) {
-    if (token_index < MAX_TOKENS) {
-        tokens[token_index].tipo = tipo;
-        strcpy(tokens[token_index].lexema, lexema);
-        tokens[token_index].linea = linea;
-        token_index++;
-    }
-}
-
-void analizar_linea(char* linea, int numero_linea) {
-    char *p = linea;
-    while (*p) {
-        if (isspace(*p)) {
-            p++;
-        } else if (strchr("[]{},:", *p)) {
-            char simbolo[2] = {*p, '\0'};
-            switch (*p) {
-                case '[': agregar_token(L_CORCHETE, simbolo, numero_linea); break;
-                case ']': agregar_token(R_CORCHETE, simbolo, numero_linea); break;
-                case '{': agregar_token(L_LLAVE, simbolo, numero_linea); break;
-                case '}': agregar_token(R_LLAVE, simbolo, numero_linea); break;
-                case ',': agregar_token(COMA, simbolo, numero_linea); break;
-                case ':': agregar_token(DOS_PUNTOS, simbolo, numero_linea); break;
-            }
-            p++;
-        } else if (*p == '"') {
-            char buffer[1024] = {0};
-            char *inicio = p++;
-            while (*p && *p != '"') p++;
-            if (*p == '"') p++;
-            strncpy(buffer, inicio, p - inicio);
-            agregar_token(STRING, buffer, numero_linea);
+static void empujar_posicion(TokenType tipo, uint32_t inicio, uint32_t largo) {
+    if (tokens.n == tokens.cap) {
+        tokens.cap = tokens.cap ? tokens.cap * 2 : 1024;
+        tokens.tipo = (unsigned char*)xrealloc(tokens.tipo, tokens.cap);
+        tokens.inicio = (uint32_t*)xrealloc(tokens.inicio, tokens.cap * sizeof(uint32_t));
+        tokens.largo = (uint32_t*)xrealloc(tokens.largo, tokens.cap * sizeof(uint32_t));
+    }
+    tokens.tipo[tokens.n] = (unsigned char)tipo;
+    tokens.inicio[tokens.n] = inicio;
+    tokens.largo[tokens.n] = largo;
+    tokens.n++;
+}
+
+static void empujar_token(TokenType tipo, const char* lexema, size_t largo) {
+    empujar_posicion(tipo, (uint32_t)(lexema - fuente), (uint32_t)largo);
+}
+
+void agregar_token(TokenType tipo, const char* lexema, size_t largo) {
+    empujar_token(tipo, lexema, largo);
+    EST(est_token(tipo));
+    if (!modo_stream) return;
+    if (tipo == L_LLAVE || tipo == L_CORCHETE) {
+        profundidad++;
+        return;
+    }
+    if ((tipo == R_LLAVE || tipo == R_CORCHETE) && profundidad > 0) profundidad--;
+    // En la posicion del token que cierra el documento, asi queda en su linea
+    if (profundidad == 0)
+        empujar_token(EOF_TOKEN, lexema, 0);
+}
+
+// Reserva n bytes (y un '\0' detras) al final del texto fuente
+static char *reservar_fuente(size_t n) {
+    if (fuente_len + n + 1 > UINT32_MAX) {
+        printf("Archivo demasiado grande (maximo 4 GB)\n");
+        exit(1);
+    }
+    if (fuente_len + n + 1 > fuente_cap) {
+        fuente_cap = fuente_cap ? fuente_cap * 2 : 1 << 16;
+        while (fuente_cap < fuente_len + n + 1) fuente_cap *= 2;
+        fuente = (char*)xrealloc(fuente, fuente_cap);
+    }
+    return fuente + fuente_len;
+}
+
+// Agrega texto al final de la fuente y devuelve donde quedo copiado
+char *agregar_fuente(const char *texto, size_t n) {
+    char *dst = reservar_fuente(n);
+    memcpy(dst, texto, n);
+    dst[n] = '\0';
+    fuente_len += n;
+    return dst;
+}
+
+// Lineas: solo se guardan las posiciones de los '\n' de la fuente, y se
+// buscan recien cuando hace falta el numero de linea de un token (en un
+// error). El indice llega hasta saltos_hasta y se completa con memchr; en
+// --stream lo que se descarta de la fuente queda en lineas_descartadas.
+size_t *saltos = NULL;
+size_t saltos_n = 0, saltos_cap = 0, saltos_hasta = 0;
+int lineas_descartadas = 0;
+
+static void agregar_salto(size_t pos) {
+    if (saltos_n == saltos_cap) {
+        saltos_cap = saltos_cap ? saltos_cap * 2 : 1024;
+        saltos = (size_t*)xrealloc(saltos, saltos_cap * sizeof(size_t));
+    }
+    saltos[saltos_n++] = pos;
+}
+
+static void indexar_saltos(size_t hasta) {
+    while (saltos_hasta < hasta) {
+        const char *s = (const char*)memchr(fuente + saltos_hasta, '\n', hasta - saltos_hasta);
+        if (!s) break;
+        saltos_hasta = (size_t)(s - fuente);
+        agregar_salto(saltos_hasta++);
+    }
+    if (saltos_hasta < hasta) saltos_hasta = hasta;
+}
+
+// Saltos antes de pos (busqueda binaria en el indice)
+static size_t saltos_antes(size_t pos) {
+    indexar_saltos(pos);
+    size_t a = 0, b = saltos_n;
+    while (a < b) {
+        size_t m = a + (b - a) / 2;
+        if (saltos[m] < pos) a = m + 1;
+        else b = m;
+    }
+    return a;
+}
+
+static int linea_de(size_t pos) { return lineas_descartadas + (int)saltos_antes(pos) + 1; }
+static int linea_token(size_t i) { return linea_de(tokens.inicio[i]); }
+
+// Como con fgets, una ultima linea sin '\n' tambien cuenta: el EOF_TOKEN
+// va detras de un salto agregado al final de la fuente
+static char *fin_fuente(int salto_final) {
+    return salto_final ? agregar_fuente("", 0) : agregar_fuente("\n", 1) + 1;
+}
+
+// El lexer no depende de las lineas: la entrada se lee de a bloques de
+// LEX_BLOQUE bytes y un token que queda cortado al final de un bloque
+// sigue en el proximo, con su estado (cadena, escape o el AFD del
+// escalar), sin volver a recorrer lo ya visto. Una cadena termina en su
+// comilla o antes del fin de la linea. El modo normal y --validar usan el
+// mismo lex_bloque: cambia a donde van los tokens (el sumidero) y si las
+// lineas se cuentan al pasar (--validar) o despues (ver linea_de).
+#define LEX_BLOQUE 65536
+
+enum { V_NADA, V_CADENA, V_ESCAPE, V_ESCALAR };   // token a medias entre bloques
+
+// Recibe cada token de lex_bloque, en [inicio, inicio + largo) de la
+// entrada; con 0 el analisis se corta (--validar, en el primer error)
+typedef int (*Sumidero)(TokenType t, size_t inicio, size_t largo);
+
+struct {
+    unsigned char modo, afd;   // V_*; afd: estado de lx_escalar
+    size_t inicio;             // en la entrada, del token a medias
+    char palabra[8];           // primeros bytes del escalar (para lx_fin_escalar:
+    size_t nescalar;           // con --validar su bloque puede no estar mas)
+    int salto_final;           // la entrada leida termina en '\n' (o esta vacia)
+    int lineas;                // contar las lineas al pasar (--validar)
+    int linea, linea_tok;      // con lineas: la actual y la del ultimo token
+} lex = { V_NADA, 0, 0, {0}, 0, 1, 0, 1, 1 };
+
+// Lee el proximo bloque de la entrada al final de la fuente; con --stats
+// cuenta como fase "leer" y lo que sigue como "lexico". Devuelve lo leido.
+static size_t leer_bloque(FILE *f) {
+    EST(est_fase(EST_LEER));
+    char *dst = reservar_fuente(LEX_BLOQUE);
+    size_t n = fread(dst, 1, LEX_BLOQUE, f);
+    dst[n] = '\0';
+    fuente_len += n;
+    if (n) lex.salto_final = dst[n - 1] == '\n';
+    EST(est.bytes_entrada += n; est_fase(EST_LEXICO));
+    return n;
+}
+
+// Primer byte >= i que no es blanco JSON, segun las mascaras del bloque.
+static size_t saltar_espacios(const IdxBloque *m, size_t n, size_t i) {
+    while (i < n) {
+        uint64_t libres = ~m[i / IDX_BLOQUE].espacios >> (i % IDX_BLOQUE);
+        if (libres) return i + idx_ctz(libres);
+        i = (i / IDX_BLOQUE + 1) * IDX_BLOQUE;
+    }
+    return n;
+}
+
+// Saltos de linea en [i, j), de a un bloque de mascara por vez
+static int contar_saltos(const IdxBloque *m, size_t i, size_t j) {
+    int n = 0;
+    for (size_t a = i; a < j; a = (a / IDX_BLOQUE + 1) * IDX_BLOQUE) {
+        uint64_t x = m[a / IDX_BLOQUE].saltos >> (a % IDX_BLOQUE);
+        if ((a / IDX_BLOQUE + 1) * IDX_BLOQUE > j) x &= (1ULL << (j - a)) - 1;
+#if defined(__GNUC__)
+        n += __builtin_popcountll(x);
+#else
+        for (; x; x &= x - 1) n++;
+#endif
+    }
+    return n;
+}
+
+// Sigue la cadena abierta desde b[i]: devuelve donde termino (lex.modo
+// vuelve a V_NADA), o n si sigue en el proximo bloque. La regla es la de
+// lx_cadena_linea (comun/lexico.h), la misma del lexer, asi los tokens de
+// lexer --tokens son los de aca: el '\n' que corta la linea, escapado o
+// no, cierra la cadena y queda afuera.
+static size_t lex_cadena(const char *b, const IdxBloque *m, size_t n, size_t i) {
+    if (lex.modo == V_ESCAPE) {
+        if (i >= n) return n;
+        if (b[i] == '\n') {
+            lex.modo = V_NADA;
+            return i;
+        }
+        i++;
+        lex.modo = V_CADENA;
+    }
+    while (i < n) {
+        const IdxBloque *k = &m[i / IDX_BLOQUE];
+        uint64_t x = (k->comillas | k->barras | k->saltos) >> (i % IDX_BLOQUE);
+        if (!x) {
+            i = (i / IDX_BLOQUE + 1) * IDX_BLOQUE;
+            continue;
+        }
+        i += idx_ctz(x);
+        if (i >= n) break;
+        if (b[i] == '"') { lex.modo = V_NADA; return i + 1; }
+        if (b[i] == '\n') { lex.modo = V_NADA; return i; }
+        if (i + 1 == n) { lex.modo = V_ESCAPE; return n; }
+        if (b[i + 1] == '\n') { lex.modo = V_NADA; return i + 1; }
+        i += 2;
+    }
+    return n;
+}
+
+// Sigue el escalar abierto desde b[i]: devuelve donde termino, o n
+static size_t lex_escalar(const char *b, size_t n, size_t i) {
+    size_t k = lx_escalar(&lex.afd, b + i, n - i);
+    for (size_t j = 0; j < k && lex.nescalar + j < sizeof(lex.palabra); j++)
+        lex.palabra[lex.nescalar + j] = b[i + j];
+    lex.nescalar += k;
+    return i + k;
+}
+
+// Cierra el token a medias, que termina en fin
+static inline int cerrar_token(Sumidero sumidero, size_t fin) {
+    TokenType t = STRING;
+    if (lex.modo == V_ESCALAR) {
+        size_t n = lex.nescalar < sizeof(lex.palabra) ? lex.nescalar : sizeof(lex.palabra);
+        t = (TokenType)lx_fin_escalar(lex.afd, lex.palabra, n);
+    }
+    lex.modo = V_NADA;
+    return sumidero(t, lex.inicio, fin - lex.inicio);
+}
+
+// Un bloque: b[0..n) esta en desde de la entrada y m son sus mascaras.
+// 0 si el sumidero corto el analisis. Inline: en cada camino el sumidero
+// queda fijo y no cuesta una llamada indirecta por token.
+static inline int lex_bloque(Sumidero sumidero, const char *b, size_t desde, size_t n, const IdxBloque *m) {
+    size_t i = 0;
+    if (lex.modo == V_CADENA || lex.modo == V_ESCAPE) {
+        i = lex_cadena(b, m, n, 0);
+        if (lex.modo == V_NADA && !cerrar_token(sumidero, desde + i)) return 0;
+    } else if (lex.modo == V_ESCALAR) {
+        i = lex_escalar(b, n, 0);
+        if (i < n && !cerrar_token(sumidero, desde + i)) return 0;
+    }
+    while (i < n) {
+        unsigned clase = lx_clase[(unsigned char)b[i]];
+        if (clase <= LXC_DOS_PUNTOS) {
+            lex.linea_tok = lex.linea;
+            if (!sumidero((TokenType)clase, desde + i, 1)) return 0;
+            i++;
+        } else if (clase == LXC_BLANCO || clase == LXC_SALTO) {
+            size_t j = saltar_espacios(m, n, i + 1);
+            if (lex.lineas) lex.linea += contar_saltos(m, i, j);
+            i = j;
         } else {
-            char buffer[1024] = {0};
-            int i = 0;
-            while (*p && !isspace(*p) && !strchr("[]{},:", *p)) {
-                buffer[i++] = *p++;
-            }
-            buffer[i] = '\0';
-
-            if (_stricmp(buffer, "true") == 0) agregar_token(PR_TRUE, buffer, numero_linea);
-            else if (_stricmp(buffer, "false") == 0) agregar_token(PR_FALSE, buffer, numero_linea);
-            else if (_stricmp(buffer, "null") == 0) agregar_token(PR_NULL, buffer, numero_linea);
-            else {
-                int esNumero = 1;
-                int j;
-                for (j = 0; buffer[j]; j++) {
-                    if (!isdigit(buffer[j]) && buffer[j] != '.' && buffer[j] != 'e' &&
-                        buffer[j] != 'E' && buffer[j] != '+' && buffer[j] != '-') {
-                        esNumero = 0;
-                        break;
-                    }
-                }
-                if (esNumero)
-                    agregar_token(NUMBER, buffer, numero_linea);
-                else
-                    agregar_token(ERROR_TOKEN, buffer, numero_linea);
+            lex.inicio = desde + i;
+            lex.linea_tok = lex.linea;
+            if (clase == LXC_COMILLA) {
+                lex.modo = V_CADENA;
+                i = lex_cadena(b, m, n, i + 1);
+                if (lex.modo == V_NADA && !cerrar_token(sumidero, desde + i)) return 0;
+            } else {
+                lex.modo = V_ESCALAR;
+                lex.afd = LXA_INICIO;
+                lex.nescalar = 0;
+                i = lex_escalar(b, n, i);
+                if (i < n && !cerrar_token(sumidero, desde + i)) return 0;
             }
         }
     }
+    return 1;
+}
+
+// Sumidero del modo normal: los tokens van a tokens, con su texto en fuente
+static int al_flujo(TokenType t, size_t inicio, size_t largo) {
+    agregar_token(t, fuente + inicio, largo);
+    return 1;
+}
+
+// Lexea fuente[desde, hasta) a continuacion de lo anterior. Las mascaras
+// (comun/indice.h) se arman de a un bloque. Con fin la entrada termina en
+// hasta y el token que quedo a medias se cierra ahi.
+static void lexear(size_t desde, size_t hasta, int fin) {
+    static IdxBloque m[LEX_BLOQUE / IDX_BLOQUE];
+    while (desde < hasta) {
+        size_t n = hasta - desde < LEX_BLOQUE ? hasta - desde : LEX_BLOQUE;
+        idx_clasificar(fuente + desde, n, m);
+        lex_bloque(al_flujo, fuente + desde, desde, n, m);
+        desde += n;
+    }
+    if (fin && lex.modo != V_NADA) cerrar_token(al_flujo, hasta);
+}
+
+// Una linea suelta (modo incremental): empieza sin token a medias y lo
+// que quede abierto se cierra en su fin
+static void analizar_linea(size_t desde, size_t hasta) {
+    lexear(desde, hasta, 1);
+}
+
+// Tokens ya analizados por el lexer (lexer --tokens, comun/flujo.h): se
+// cargan sin analizar la fuente, que solo se lee para comparar su huella.
+// 0 si el archivo no es valido o la fuente cambio desde que se escribio.
+// Las posiciones quedan en bytes de la fuente, que no se carga: el indice
+// de lineas se arma con los saltos del archivo.
+static int cargar_flujo(const char *ruta, const char *nombre) {
+    FlujoLector r;
+    if (!flujo_abrir(&r, ruta)) return 0;
+    if (!flujo_vigente(&r, nombre) || r.cab.largo_fuente >= UINT32_MAX) {
+        flujo_cerrar(&r);
+        return 0;
+    }
+    EST(est_fase(EST_LEER); est.bytes_entrada += r.largo; est_fase(EST_LEXICO));
+    FlujoToken t;
+    uint64_t fin_linea = 0;             // despues del ultimo salto
+    while (flujo_siguiente(&r, &t)) {
+        if (t.tipo == FLUJO_SALTO) {
+            agregar_salto((size_t)t.inicio);
+            fin_linea = t.inicio + t.largo;
+            continue;
+        }
+        empujar_posicion((TokenType)t.tipo, (uint32_t)t.inicio, (uint32_t)t.largo);
+        EST(est_token(t.tipo));
+    }
+    if (r.error) {                      // archivo cortado: se descarta
+        flujo_cerrar(&r);
+        tokens.n = 0;
+        saltos_n = 0;
+        return 0;
+    }
+    // Como con fgets: una ultima linea sin '\n' tambien cuenta (fin_fuente)
+    uint64_t largo_fuente = r.cab.largo_fuente;
+    flujo_cerrar(&r);
+    if (largo_fuente > fin_linea) agregar_salto((size_t)largo_fuente++);
+    saltos_hasta = (size_t)largo_fuente;
+    empujar_posicion(EOF_TOKEN, (uint32_t)largo_fuente, 0);
+    EST(est_token(EOF_TOKEN));
+    return 1;
 }
 
 // ==================== ANALIZADOR SINTÁCTICO ====================
 
-Token actual() { return tokens[current]; }
-void avanzar() { if (current < token_index) current++; }
+// Tipo del token actual: ya no se copia el token completo en cada consulta
+inline TokenType actual() { return (TokenType)tokens.tipo[current]; }
+
+// Modo incremental: los tokens se cargan por lineas a medida que hacen falta
+void (*rellenar_tokens)() = NULL;
+
+void avanzar() {
+    if (current < tokens.n) current++;
+    if (current == tokens.n && rellenar_tokens) rellenar_tokens();
+}
+
+// Ultimo error informado (el modo incremental lo guarda en su cache)
+int error_linea = 0;
+char error_msg[256];
+
+static void error_sintactico(int linea, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    vsnprintf(error_msg, sizeof(error_msg), fmt, ap);
+    va_end(ap);
+    error_linea = linea;
+    printf("Error en línea %d: %s\n", linea, error_msg);
+}
 
 int aceptar(TokenType tipo) {
-    if (actual().tipo == tipo) {
+    if (actual() == tipo) {
         avanzar();
         return 1;
     }
@@ -108,96 +427,810 @@ int aceptar(TokenType tipo) {
 
 int esperar(TokenType tipo) {
     if (aceptar(tipo)) return 1;
-    printf("Error en línea %d: se esperaba %s, se encontró %s\n",
-           actual().linea, token_names[tipo], token_names[actual().tipo]);
+    error_sintactico(linea_token(current), "se esperaba %s, se encontró %s",
+                     token_names[tipo], token_names[actual()]);
     return 0;
 }
 
-int attribute();
-int attributes_list();
-int object();
-int element();
-int element_list();
-int array();
-int attribute_value();
+// Gramatica:
+//   json            -> element EOF
+//   element         -> object | array
+//   object          -> { } | { attributes_list }
+//   attributes_list -> attribute (, attribute)*
+//   attribute       -> STRING : attribute_value
+//   attribute_value -> element | STRING | NUMBER | true | false | null
+//   array           -> [ ] | [ element_list ]
+//   element_list    -> element (, element)*
+//
+// Se recorre sin recursion: la pila guarda el tipo de cada objeto o array
+// abierto, asi el anidamiento no consume pila de C y se limita con
+// max_profundidad. Ante el primer error se abandona el analisis.
+
+#define MAX_PROFUNDIDAD 10000
+
+size_t max_profundidad = MAX_PROFUNDIDAD;
+unsigned char *pila = NULL;             // L_LLAVE o L_CORCHETE por nivel
+size_t pila_n = 0, pila_cap = 0;
+
+enum Estado { E_ELEMENTO, E_ATRIBUTO, E_VALOR, E_SIGUIENTE };
 
-int attribute() {
-    if (!esperar(STRING)) return 0;
-    if (!esperar(DOS_PUNTOS)) return 0;
-    return attribute_value();
+// Modo incremental: cada nivel de la pila es tambien un nodo inmutable
+// (ver MODO INCREMENTAL) y al empezar cada paso se consulta registrar,
+// que puede cortar el analisis (json_desde devuelve 2).
+#define NODO_NINGUNO UINT32_MAX
+uint32_t *pila_nodo = NULL;
+uint32_t nuevo_nodo(uint32_t padre, unsigned char tipo);
+int (*registrar)(Estado e) = NULL;
+
+static void apilar(TokenType t) {
+    if (pila_n == pila_cap) {
+        pila_cap = pila_cap ? pila_cap * 2 : 64;
+        pila = (unsigned char*)xrealloc(pila, pila_cap);
+        if (registrar) pila_nodo = (uint32_t*)xrealloc(pila_nodo, pila_cap * sizeof(uint32_t));
+    }
+    if (registrar)
+        pila_nodo[pila_n] = nuevo_nodo(pila_n ? pila_nodo[pila_n - 1] : NODO_NINGUNO,
+                                       (unsigned char)t);
+    pila[pila_n++] = (unsigned char)t;
+    EST(est_profundidad(pila_n));
 }
 
-int attributes_list() {
-    if (!attribute()) return 0;
-    while (aceptar(COMA)) {
-        if (!attribute()) return 0;
+// Analiza desde el token actual con la pila ya armada y la maquina en e
+int json_desde(Estado e) {
+    for (;;) {
+        if (registrar && registrar(e)) return 2;
+        switch (e) {
+        case E_ELEMENTO: {
+            TokenType t = actual();
+            if (t != L_LLAVE && t != L_CORCHETE) return 0;
+            if (pila_n == max_profundidad) {
+                error_sintactico(linea_token(current),
+                                 "se excedió la profundidad máxima (%zu)", max_profundidad);
+                return 0;
+            }
+            avanzar();
+            if (aceptar(t == L_LLAVE ? R_LLAVE : R_CORCHETE)) { e = E_SIGUIENTE; break; }
+            apilar(t);
+            e = t == L_LLAVE ? E_ATRIBUTO : E_ELEMENTO;
+            break;
+        }
+        case E_ATRIBUTO:
+            if (!esperar(STRING)) return 0;
+            if (!esperar(DOS_PUNTOS)) return 0;
+            e = E_VALOR;
+            break;
+        case E_VALOR: {
+            TokenType t = actual();
+            if (t == STRING || t == NUMBER || t == PR_TRUE || t == PR_FALSE || t == PR_NULL) {
+                avanzar();
+                e = E_SIGUIENTE;
+            } else {
+                e = E_ELEMENTO;
+            }
+            break;
+        }
+        case E_SIGUIENTE:
+            // Termino un elemento: sigue otro del mismo nivel o se cierra el nivel
+            if (pila_n == 0) return (actual() == EOF_TOKEN);
+            if (pila[pila_n - 1] == L_LLAVE) {
+                if (aceptar(COMA)) { e = E_ATRIBUTO; break; }
+                if (!esperar(R_LLAVE)) return 0;
+            } else {
+                if (aceptar(COMA)) { e = E_ELEMENTO; break; }
+                if (!esperar(R_CORCHETE)) return 0;
+            }
+            pila_n--;
+            break;
+        }
     }
-    return 1;
 }
 
-int object() {
-    if (!esperar(L_LLAVE)) return 0;
-    if (aceptar(R_LLAVE)) return 1;
-    if (!attributes_list()) return 0;
-    return esperar(R_LLAVE);
+int json() {
+    pila_n = 0;
+    return json_desde(E_ELEMENTO);
 }
 
-int element_list() {
-    if (!element()) return 0;
-    while (aceptar(COMA)) {
-        if (!element()) return 0;
+// ==================== MODO INCREMENTAL ====================
+// --incremental CACHE: para re-validar en cada guardado desde un editor.
+// El cache guarda, por linea, un hash del texto, los tipos de sus tokens y
+// el estado del parser al empezar la linea. El lexer no arrastra estado de
+// una linea a otra, asi que una linea con el mismo hash da los mismos
+// tokens. En la corrida siguiente:
+//   - solo se lexean las lineas entre el prefijo y el sufijo sin cambios;
+//   - el parser retoma desde el ultimo estado guardado antes del cambio;
+//   - ya en el sufijo, si llega a una linea con el mismo estado que la vez
+//     anterior, el resto del analisis seria identico y se corta ahi.
+// Si el analisis se corta por un error, las lineas del sufijo que siguen
+// conservan el estado y el resultado que tenian: no son el estado real de
+// este texto (no sirven para retomar) pero si para cortar la proxima vez,
+// cuando se corrija el error.
+// La pila es una lista de nodos inmutables (padre, tipo y hash de toda la
+// pila hasta ese nivel): el estado de una linea es la maquina mas el nodo
+// del tope, y comparar dos estados es O(1). El archivo se sigue leyendo y
+// hasheando entero, pero el lexico y la sintaxis cuestan segun la edicion.
+
+typedef struct {
+    uint32_t padre;
+    uint32_t prof;             // niveles hasta este, inclusive
+    uint64_t hash;             // de la pila completa hasta este nivel
+    unsigned char tipo;        // L_LLAVE o L_CORCHETE
+} Nodo;
+
+enum { SIN_ESTADO, ESTADO_REAL, ESTADO_COLA };
+
+typedef struct {
+    unsigned char valido;      // SIN_ESTADO si el parser cruzo la linea a mitad de
+                               // un paso; ESTADO_COLA: solo para cortar (ver arriba)
+    unsigned char estado;      // Estado
+    uint32_t nodo;             // tope de la pila o NODO_NINGUNO
+    uint32_t resultado;        // al que lleva analizar desde aqui
+} EstadoLinea;
+
+typedef struct {
+    int32_t ok, error_linea;   // error_linea 0: sin mensaje
+    char error_msg[256];
+} Resultado;
+
+#define CACHE_MAGIA "T2INC02"
+
+typedef struct {
+    uint64_t nlineas, ntipos, nnodos, nresultados, max_profundidad;
+} CacheCabecera;
+
+// Lo que se carga del cache anterior y lo que se arma en esta corrida
+typedef struct {
+    CacheCabecera c;
+    uint64_t *hash;
+    uint32_t *ntok;
+    size_t *tok;               // primer tipo de cada linea en tipos
+    unsigned char *tipos;
+    EstadoLinea *est;          // nlineas + 1: el ultimo es el del EOF
+    Resultado *res;
+} Cache;
+
+Nodo *nodos = NULL;
+size_t nnodos = 0, nodos_cap = 0;
+
+uint32_t nuevo_nodo(uint32_t padre, unsigned char tipo) {
+    if (nnodos == UINT32_MAX) {
+        printf("Demasiados objetos y arrays para el modo incremental\n");
+        exit(1);
     }
-    return 1;
+    if (nnodos == nodos_cap) {
+        nodos_cap = nodos_cap ? nodos_cap * 2 : 1024;
+        nodos = (Nodo*)xrealloc(nodos, nodos_cap * sizeof(Nodo));
+    }
+    Nodo *n = &nodos[nnodos];
+    uint64_t h = padre == NODO_NINGUNO ? 0 : nodos[padre].hash;
+    h = (h ^ tipo) * 0x9E3779B97F4A7C15ULL;
+    n->padre = padre;
+    n->prof = padre == NODO_NINGUNO ? 1 : nodos[padre].prof + 1;
+    n->hash = h ^ (h >> 29);
+    n->tipo = tipo;
+    return (uint32_t)nnodos++;
 }
 
-int array() {
-    if (!esperar(L_CORCHETE)) return 0;
-    if (aceptar(R_CORCHETE)) return 1;
-    if (!element_list()) return 0;
-    return esperar(R_CORCHETE);
+static uint64_t hash_linea(const char *s, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n, w;
+    for (; n >= 8; s += 8, n -= 8) {
+        memcpy(&w, s, 8);
+        h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+        h ^= h >> 32;
+    }
+    w = 0;
+    memcpy(&w, s, n);
+    h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+    return h ^ (h >> 29);
 }
 
-int attribute_value() {
-    TokenType t = actual().tipo;
-    if (t == STRING || t == NUMBER || t == PR_TRUE || t == PR_FALSE || t == PR_NULL) {
-        avanzar();
-        return 1;
+static int mismo_estado(EstadoLinea a, EstadoLinea b) {
+    if (a.valido != ESTADO_REAL || !b.valido || a.estado != b.estado) return 0;
+    if (a.nodo == NODO_NINGUNO || b.nodo == NODO_NINGUNO) return a.nodo == b.nodo;
+    return nodos[a.nodo].hash == nodos[b.nodo].hash && nodos[a.nodo].prof == nodos[b.nodo].prof;
+}
+
+// Cache vacio si no existe, esta corrupto o es de otro --max-depth
+static void cache_leer(const char *ruta, Cache *k) {
+    memset(k, 0, sizeof(*k));
+    k->est = (EstadoLinea*)xrealloc(NULL, sizeof(EstadoLinea));
+    k->est[0].valido = 0;
+    FILE *f = fopen(ruta, "rb");
+    if (!f) return;
+    char magia[8];
+    CacheCabecera c;
+    int bien = fread(magia, 8, 1, f) == 1 && memcmp(magia, CACHE_MAGIA, 8) == 0 &&
+               fread(&c, sizeof(c), 1, f) == 1 && c.max_profundidad == max_profundidad &&
+               c.nlineas < UINT32_MAX && c.nnodos < UINT32_MAX && c.ntipos <= UINT32_MAX &&
+               c.nresultados <= c.nlineas + 1;
+    if (bien) {
+        k->hash = (uint64_t*)xrealloc(NULL, c.nlineas * sizeof(uint64_t) + 1);
+        k->ntok = (uint32_t*)xrealloc(NULL, c.nlineas * sizeof(uint32_t) + 1);
+        k->tok = (size_t*)xrealloc(NULL, c.nlineas * sizeof(size_t) + 1);
+        k->tipos = (unsigned char*)xrealloc(NULL, c.ntipos + 1);
+        k->est = (EstadoLinea*)xrealloc(k->est, (c.nlineas + 1) * sizeof(EstadoLinea));
+        k->res = (Resultado*)xrealloc(NULL, c.nresultados * sizeof(Resultado) + 1);
+        nodos_cap = c.nnodos + 1024;
+        nodos = (Nodo*)xrealloc(nodos, nodos_cap * sizeof(Nodo));
+        bien = fread(k->hash, sizeof(uint64_t), c.nlineas, f) == c.nlineas &&
+               fread(k->ntok, sizeof(uint32_t), c.nlineas, f) == c.nlineas &&
+               fread(k->tipos, 1, c.ntipos, f) == c.ntipos &&
+               fread(k->est, sizeof(EstadoLinea), c.nlineas + 1, f) == c.nlineas + 1 &&
+               fread(nodos, sizeof(Nodo), c.nnodos, f) == c.nnodos &&
+               fread(k->res, sizeof(Resultado), c.nresultados, f) == c.nresultados;
+    }
+    fclose(f);
+    // Que los indices no se salgan: un cache corrupto no debe romper nada
+    size_t t = 0;
+    for (size_t i = 0; bien && i < c.nlineas; i++) {
+        k->tok[i] = t;
+        t += k->ntok[i];
     }
-    return element();
+    bien = bien && t == c.ntipos;
+    for (size_t i = 0; bien && i < c.nnodos; i++)
+        bien = nodos[i].padre == NODO_NINGUNO || nodos[i].padre < i;
+    for (size_t i = 0; bien && i <= c.nlineas; i++)
+        bien = !k->est[i].valido || ((k->est[i].nodo == NODO_NINGUNO || k->est[i].nodo < c.nnodos) &&
+                                     k->est[i].resultado < c.nresultados);
+    for (size_t i = 0; bien && i < c.nresultados; i++)
+        k->res[i].error_msg[sizeof(k->res[i].error_msg) - 1] = '\0';
+    if (!bien) {
+        nnodos = 0;
+        k->est[0].valido = 0;
+        return;
+    }
+    k->c = c;
+    nnodos = c.nnodos;
 }
 
-int element() {
-    if (actual().tipo == L_LLAVE) return object();
-    if (actual().tipo == L_CORCHETE) return array();
+// Guarda solo los nodos que usa algun estado, renumerados en orden (el
+// padre siempre queda antes que el hijo). Se escribe aparte y se renombra
+// para no dejar un cache a medias.
+static int cache_escribir(const char *ruta, Cache *k) {
+    uint32_t *nuevo = (uint32_t*)xrealloc(NULL, nnodos * sizeof(uint32_t) + 1);
+    for (size_t i = 0; i < nnodos; i++) nuevo[i] = NODO_NINGUNO;
+    for (size_t i = 0; i <= k->c.nlineas; i++) {
+        if (!k->est[i].valido) continue;
+        for (uint32_t x = k->est[i].nodo; x != NODO_NINGUNO && nuevo[x]; x = nodos[x].padre)
+            nuevo[x] = 0;      // marcado como vivo
+    }
+    size_t vivos = 0;
+    for (size_t i = 0; i < nnodos; i++) {
+        if (nuevo[i]) continue;
+        nuevo[i] = (uint32_t)vivos;
+        nodos[vivos] = nodos[i];
+        if (nodos[vivos].padre != NODO_NINGUNO) nodos[vivos].padre = nuevo[nodos[vivos].padre];
+        vivos++;
+    }
+    for (size_t i = 0; i <= k->c.nlineas; i++)
+        if (k->est[i].valido && k->est[i].nodo != NODO_NINGUNO) k->est[i].nodo = nuevo[k->est[i].nodo];
+        else if (!k->est[i].valido) k->est[i].nodo = NODO_NINGUNO;
+    free(nuevo);
+    nnodos = vivos;
+    k->c.nnodos = vivos;
+
+    size_t n = strlen(ruta);
+    char *tmp = (char*)xrealloc(NULL, n + 5);
+    memcpy(tmp, ruta, n);
+    memcpy(tmp + n, ".tmp", 5);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        free(tmp);
+        return 0;
+    }
+    int bien = fwrite(CACHE_MAGIA, 8, 1, f) == 1 &&
+               fwrite(&k->c, sizeof(k->c), 1, f) == 1 &&
+               fwrite(k->hash, sizeof(uint64_t), k->c.nlineas, f) == k->c.nlineas &&
+               fwrite(k->ntok, sizeof(uint32_t), k->c.nlineas, f) == k->c.nlineas &&
+               fwrite(k->tipos, 1, k->c.ntipos, f) == k->c.ntipos &&
+               fwrite(k->est, sizeof(EstadoLinea), k->c.nlineas + 1, f) == k->c.nlineas + 1 &&
+               fwrite(nodos, sizeof(Nodo), nnodos, f) == nnodos &&
+               fwrite(k->res, sizeof(Resultado), k->c.nresultados, f) == k->c.nresultados;
+    bien = fclose(f) == 0 && bien;
+#ifdef _WIN32
+    if (bien) remove(ruta);    // rename no reemplaza en Windows
+#endif
+    bien = bien && rename(tmp, ruta) == 0;
+    if (!bien) remove(tmp);
+    free(tmp);
+    return bien;
+}
+
+// Estado de la corrida incremental
+Cache vieja, nueva;
+size_t prefijo, sufijo;        // lineas nuevas [0, prefijo) y [sufijo, N) sin cambios
+ptrdiff_t delta;               // linea vieja = linea nueva + delta (en el sufijo)
+unsigned char *lex_tipos = NULL;   // tipos de las lineas [prefijo, sufijo) relexadas
+size_t *lex_tok = NULL;
+size_t *inicio_linea = NULL;   // posicion de cada linea en fuente (sus tokens van ahi)
+size_t linea_sig;              // proxima linea a cargar en el flujo de tokens
+size_t prox_registro;          // primera linea sin estado registrado
+size_t desde_linea;            // donde retomo el parser
+size_t convergio = SIZE_MAX;   // linea donde el estado volvio a ser el de antes
+
+static const unsigned char *tipos_linea(size_t l, uint32_t *n) {
+    if (l >= prefijo && l < sufijo) {
+        *n = (uint32_t)(lex_tok[l - prefijo + 1] - lex_tok[l - prefijo]);
+        return lex_tipos + lex_tok[l - prefijo];
+    }
+    size_t v = l < prefijo ? l : (size_t)((ptrdiff_t)l + delta);
+    *n = vieja.ntok[v];
+    return vieja.tipos + vieja.tok[v];
+}
+
+static void rellenar_incremental() {
+    size_t nl = (size_t)nueva.c.nlineas;
+    while (current == tokens.n) {
+        if (linea_sig == nl) {
+            empujar_posicion(EOF_TOKEN, (uint32_t)fuente_len, 0);
+            return;
+        }
+        uint32_t n;
+        const unsigned char *t = tipos_linea(linea_sig, &n);
+        for (uint32_t i = 0; i < n; i++) empujar_posicion((TokenType)t[i], (uint32_t)inicio_linea[linea_sig], 0);
+        linea_sig++;
+    }
+}
+
+// Al empezar cada paso: las lineas cuyo primer token es el actual empiezan
+// en este estado. Las que se cruzaron a mitad de un paso quedan invalidas.
+static int registrar_incremental(Estado e) {
+    size_t l = (size_t)linea_token(current) - 1;
+    if (l < prox_registro) return 0;
+    size_t d = current ? (size_t)linea_token(current - 1) : desde_linea;
+    if (d < prox_registro) d = prox_registro;
+    EstadoLinea s = { ESTADO_REAL, (unsigned char)e, pila_n ? pila_nodo[pila_n - 1] : NODO_NINGUNO, 0 };
+    prox_registro = l + 1;
+    for (; d <= l; d++) {
+        nueva.est[d] = s;
+        if (d >= sufijo && mismo_estado(s, vieja.est[(ptrdiff_t)d + delta])) {
+            convergio = d;
+            return 1;
+        }
+    }
     return 0;
 }
 
-int json() {
-    if (!element()) return 0;
-    return (actual().tipo == EOF_TOKEN);
+// Arma la pila del parser a partir del nodo del tope
+static void restaurar_pila(uint32_t tope) {
+    size_t prof = tope == NODO_NINGUNO ? 0 : nodos[tope].prof;
+    EST(est_profundidad(prof));
+    if (prof > pila_cap) pila_cap = prof;
+    pila = (unsigned char*)xrealloc(pila, pila_cap + 1);
+    pila_nodo = (uint32_t*)xrealloc(pila_nodo, (pila_cap + 1) * sizeof(uint32_t));
+    pila_n = prof;
+    for (uint32_t x = tope; x != NODO_NINGUNO; x = nodos[x].padre) {
+        prof--;
+        pila[prof] = nodos[x].tipo;
+        pila_nodo[prof] = x;
+    }
+}
+
+static int validar_incremental(const char *nombre, FILE *entrada, const char *ruta_cache) {
+    // Toda la entrada y sus lineas (cada una con su '\n') con su hash
+    while (leer_bloque(entrada)) {}
+    if (entrada != stdin) fclose(entrada);
+    size_t n = 0, cap = 0;
+    inicio_linea = (size_t*)xrealloc(NULL, sizeof(size_t));
+    for (size_t a = 0; a < fuente_len; a = inicio_linea[n]) {
+        const char *salto = (const char*)memchr(fuente + a, '\n', fuente_len - a);
+        if (n == cap) {
+            cap = cap ? cap * 2 : 1024;
+            inicio_linea = (size_t*)xrealloc(inicio_linea, (cap + 1) * sizeof(size_t));
+            nueva.hash = (uint64_t*)xrealloc(nueva.hash, cap * sizeof(uint64_t));
+        }
+        inicio_linea[n] = a;
+        inicio_linea[n + 1] = salto ? (size_t)(salto - fuente) + 1 : fuente_len;
+        nueva.hash[n] = hash_linea(fuente + a, inicio_linea[n + 1] - a);
+        n++;
+    }
+    if (n >= INT32_MAX) {
+        printf("Demasiadas líneas para el modo incremental\n");
+        exit(1);
+    }
+    fin_fuente(fuente_len == 0 || fuente[fuente_len - 1] == '\n');
+
+    cache_leer(ruta_cache, &vieja);
+    size_t nv = (size_t)vieja.c.nlineas;
+    prefijo = 0;
+    while (prefijo < n && prefijo < nv && nueva.hash[prefijo] == vieja.hash[prefijo]) prefijo++;
+    size_t comun = 0;
+    while (comun < n - prefijo && comun < nv - prefijo &&
+           nueva.hash[n - 1 - comun] == vieja.hash[nv - 1 - comun]) comun++;
+    sufijo = n - comun;
+    delta = (ptrdiff_t)nv - (ptrdiff_t)n;
+
+    // Lexico solo de las lineas cambiadas
+    lex_tok = (size_t*)xrealloc(NULL, (sufijo - prefijo + 1) * sizeof(size_t));
+    for (size_t l = prefijo; l < sufijo; l++) {
+        lex_tok[l - prefijo] = tokens.n;
+        analizar_linea(inicio_linea[l], inicio_linea[l + 1]);
+    }
+    lex_tok[sufijo - prefijo] = tokens.n;
+    lex_tipos = (unsigned char*)xrealloc(NULL, tokens.n + 1);
+    memcpy(lex_tipos, tokens.tipo, tokens.n);
+    tokens.n = 0;
+
+    // El estado de una linea ya miro su primer token (tras '{' se pregunta
+    // por '}'): sirve si ese token esta en el prefijo sin cambios. Se retoma
+    // desde el ultimo asi; la linea 0 siempre empieza igual.
+    nueva.c.nlineas = n;
+    nueva.est = (EstadoLinea*)xrealloc(NULL, (n + 1) * sizeof(EstadoLinea));
+    memset(nueva.est, 0, (n + 1) * sizeof(EstadoLinea));
+    desde_linea = prefijo;
+    int con_token = 0;
+    while (desde_linea > 0) {
+        desde_linea--;
+        con_token |= vieja.ntok[desde_linea] != 0;
+        if (con_token && vieja.est[desde_linea].valido == ESTADO_REAL) break;
+    }
+    for (size_t l = 0; l < desde_linea; l++)
+        if (vieja.est[l].valido == ESTADO_REAL) nueva.est[l] = vieja.est[l];
+    EstadoLinea s = desde_linea ? vieja.est[desde_linea]
+                                : EstadoLinea{ ESTADO_REAL, E_ELEMENTO, NODO_NINGUNO, 0 };
+
+    printf("Analizando archivo: %s\n", nombre);
+    EST(est_fase(EST_SINTAXIS));
+    registrar = registrar_incremental;
+    rellenar_tokens = rellenar_incremental;
+    restaurar_pila(s.nodo);
+    current = 0;
+    linea_sig = prox_registro = desde_linea;
+    rellenar_incremental();
+    int r = json_desde((Estado)s.estado);
+    size_t hasta = convergio != SIZE_MAX ? convergio : (size_t)linea_token(current) - 1;
+    registrar = NULL;
+    rellenar_tokens = NULL;
+
+    // Resultados del cache nuevo. Cada corrida deja uno y todos los estados
+    // de su analisis lo comparten; los que vienen del cache anterior (en el
+    // sufijo) conservan el suyo, con la linea del error corrida. Al
+    // converger, el analisis sigue siendo el de la corrida que dejo ese
+    // estado: sus estados pasan a ser reales y se usa su resultado.
+    uint32_t *mapa = (uint32_t*)xrealloc(NULL, vieja.c.nresultados * sizeof(uint32_t) + 1);
+    for (size_t i = 0; i < vieja.c.nresultados; i++) mapa[i] = UINT32_MAX;
+    nueva.res = (Resultado*)xrealloc(NULL, (vieja.c.nresultados + 1) * sizeof(Resultado));
+    nueva.c.nresultados = 0;
+    uint32_t propio = 0, seguido = UINT32_MAX;
+    size_t cola = hasta + 1;
+    if (r == 2) {
+        seguido = vieja.est[(ptrdiff_t)convergio + delta].resultado;
+        cola = convergio;
+    } else {
+        Resultado *x = &nueva.res[nueva.c.nresultados++];
+        memset(x, 0, sizeof(*x));
+        x->ok = r;
+        if (error_linea) {
+            x->error_linea = error_linea;
+            strcpy(x->error_msg, error_msg);
+        }
+    }
+    for (size_t l = cola > sufijo ? cola : sufijo; l <= n; l++) {
+        EstadoLinea v = vieja.est[(ptrdiff_t)l + delta];
+        if (!v.valido) continue;
+        if (mapa[v.resultado] == UINT32_MAX) {
+            Resultado *x = &nueva.res[nueva.c.nresultados];
+            *x = vieja.res[v.resultado];
+            if (x->error_linea) x->error_linea = (int32_t)(x->error_linea - delta);
+            mapa[v.resultado] = (uint32_t)nueva.c.nresultados++;
+        }
+        v.valido = v.resultado == seguido ? ESTADO_REAL : ESTADO_COLA;
+        v.resultado = mapa[v.resultado];
+        nueva.est[l] = v;
+    }
+    if (r == 2) {
+        propio = mapa[seguido];
+        Resultado *x = &nueva.res[propio];
+        r = x->ok;
+        error_linea = x->error_linea;
+        if (error_linea) printf("Error en línea %d: %s\n", error_linea, x->error_msg);
+    }
+    free(mapa);
+    for (size_t l = 0; l < cola; l++) nueva.est[l].resultado = propio;
+    if (r)
+        printf("? El archivo %s es sintácticamente correcto.\n", nombre);
+    else
+        printf("? Se encontraron errores sintácticos en %s.\n", nombre);
+    printf("Incremental: %zu de %zu línea(s) relexada(s); sintaxis de la línea %zu a la %zu\n",
+           sufijo - prefijo, n, desde_linea + 1, hasta + 1);
+
+    // Cache para la proxima corrida
+    nueva.ntok = (uint32_t*)xrealloc(NULL, n * sizeof(uint32_t) + 1);
+    size_t total = 0;
+    for (size_t l = 0; l < n; l++) {
+        tipos_linea(l, &nueva.ntok[l]);
+        total += nueva.ntok[l];
+    }
+    nueva.tipos = (unsigned char*)xrealloc(NULL, total + 1);
+    total = 0;
+    for (size_t l = 0; l < n; l++) {
+        uint32_t k;
+        const unsigned char *t = tipos_linea(l, &k);
+        memcpy(nueva.tipos + total, t, k);
+        total += k;
+    }
+    nueva.c.ntipos = total;
+    nueva.c.max_profundidad = max_profundidad;
+    EST(est_fase(EST_SALIDA));
+    if (!cache_escribir(ruta_cache, &nueva))
+        printf("No se pudo escribir el cache %s\n", ruta_cache);
+    return 0;
+}
+
+// ==================== MODO VALIDAR ====================
+// --validar: solo la respuesta y el primer error, en una pasada sobre
+// bloques de la entrada y con memoria fija. No se guardan tokens ni texto:
+// cada token pasa directo a la misma maquina de json_desde, que aqui
+// recibe los tokens de a uno, y la pila es un bit por nivel (1 objeto,
+// 0 array), asi la memoria depende solo de la profundidad. Los tokens los
+// arma el mismo lex_bloque del modo normal, con otro sumidero, y los
+// mensajes son los mismos; ademas la entrada tiene que ser UTF-8 valido
+// (comun/utf8.h). Las lineas se cuentan al pasar, con las mascaras de
+// saltos de comun/indice.h, sin mirar la entrada de a un byte.
+
+#define VAL_BLOQUE 65536
+
+enum { V_ELEMENTO, V_ABIERTO, V_ATRIBUTO, V_DOS_PUNTOS, V_VALOR, V_SIGUIENTE };
+
+unsigned char val_estado = V_ELEMENTO;
+TokenType val_abierto;                  // en V_ABIERTO: L_LLAVE o L_CORCHETE
+uint64_t *val_pila = NULL;
+size_t val_prof = 0, val_pila_cap = 0;  // niveles y bits reservados
+
+static inline int val_objeto() {
+    size_t n = val_prof - 1;
+    return (int)(val_pila[n / 64] >> (n % 64)) & 1;
+}
+
+// Un token a la maquina; 0 ante el primer error (con mensaje donde
+// json_desde lo da). Solo el EOF_TOKEN puede terminar bien: devuelve 1.
+static int val_token(TokenType t, int linea) {
+    EST(est_token(t));
+    for (;;) {
+        switch (val_estado) {
+        case V_ELEMENTO:
+            if (t != L_LLAVE && t != L_CORCHETE) return 0;
+            if (val_prof == max_profundidad) {
+                error_sintactico(linea, "se excedió la profundidad máxima (%zu)", max_profundidad);
+                return 0;
+            }
+            val_abierto = t;
+            val_estado = V_ABIERTO;
+            return 1;
+        case V_ABIERTO:
+            if (t == (val_abierto == L_LLAVE ? R_LLAVE : R_CORCHETE)) {
+                val_estado = V_SIGUIENTE;
+                return 1;
+            }
+            if (val_prof == val_pila_cap) {
+                val_pila_cap = val_pila_cap ? val_pila_cap * 2 : 4096;
+                val_pila = (uint64_t*)xrealloc(val_pila, val_pila_cap / 8);
+            }
+            if (val_abierto == L_LLAVE) val_pila[val_prof / 64] |= 1ULL << (val_prof % 64);
+            else val_pila[val_prof / 64] &= ~(1ULL << (val_prof % 64));
+            val_prof++;
+            EST(est_profundidad(val_prof));
+            val_estado = val_abierto == L_LLAVE ? V_ATRIBUTO : V_ELEMENTO;
+            break;
+        case V_ATRIBUTO:
+        case V_DOS_PUNTOS: {
+            TokenType e = val_estado == V_ATRIBUTO ? STRING : DOS_PUNTOS;
+            if (t != e) {
+                error_sintactico(linea, "se esperaba %s, se encontró %s", token_names[e], token_names[t]);
+                return 0;
+            }
+            val_estado = val_estado == V_ATRIBUTO ? V_DOS_PUNTOS : V_VALOR;
+            return 1;
+        }
+        case V_VALOR:
+            if (t == STRING || t == NUMBER || t == PR_TRUE || t == PR_FALSE || t == PR_NULL) {
+                val_estado = V_SIGUIENTE;
+                return 1;
+            }
+            val_estado = V_ELEMENTO;
+            break;
+        case V_SIGUIENTE: {
+            if (val_prof == 0) return t == EOF_TOKEN;
+            int obj = val_objeto();
+            if (t == COMA) {
+                val_estado = obj ? V_ATRIBUTO : V_ELEMENTO;
+                return 1;
+            }
+            TokenType e = obj ? R_LLAVE : R_CORCHETE;
+            if (t != e) {
+                error_sintactico(linea, "se esperaba %s, se encontró %s", token_names[e], token_names[t]);
+                return 0;
+            }
+            val_prof--;
+            return 1;
+        }
+        }
+    }
+}
+
+// Sumidero de --validar: cada token va directo a la maquina, con la linea
+// que lex_bloque conto
+static int a_val(TokenType t, size_t, size_t) {
+    return val_token(t, lex.linea_tok);
+}
+
+static int validar_solo(const char *nombre, FILE *entrada) {
+    static char b[VAL_BLOQUE];
+    static IdxBloque m[VAL_BLOQUE / IDX_BLOQUE];
+    Utf8Estado u8;
+    utf8_iniciar(&u8);
+    printf("Analizando archivo: %s\n", nombre);
+    int ok = 1;
+    size_t n, leidos = 0;               // leidos: donde empieza b en la entrada
+    lex.lineas = 1;
+    for (;;) {
+        EST(est_fase(EST_LEER));
+        n = fread(b, 1, sizeof(b), entrada);
+        EST(est.bytes_entrada += n; est_fase(EST_LEXICO));
+        if (n == 0) break;
+        lex.salto_final = b[n - 1] == '\n';
+        size_t malo = utf8_validar(&u8, b, n);
+        idx_clasificar(b, malo, m);
+        if (!lex_bloque(a_val, b, leidos, malo, m)) { ok = 0; break; }
+        if (malo < n) {
+            error_sintactico(lex.linea, "la entrada no es UTF-8 válido");
+            ok = 0;
+            break;
+        }
+        leidos += n;
+    }
+    if (entrada != stdin) fclose(entrada);
+    if (ok && !utf8_terminar(&u8)) {
+        error_sintactico(lex.linea, "la entrada no es UTF-8 válido");
+        ok = 0;
+    }
+    if (ok) {
+        // Token a medias al final de la entrada y el EOF, en la linea que
+        // le da el modo normal (una ultima linea sin '\n' tambien cuenta)
+        if (lex.modo != V_NADA) ok = cerrar_token(a_val, leidos);
+        ok = ok && val_token(EOF_TOKEN, lex.linea + !lex.salto_final);
+    }
+    EST(est_fase(EST_SALIDA));
+    if (ok)
+        printf("? El archivo %s es sintácticamente correcto.\n", nombre);
+    else
+        printf("? Se encontraron errores sintácticos en %s.\n", nombre);
+    return 0;
 }
 
 // ==================== MAIN ====================
 
+// Estado del modo --stream
+size_t inicio_doc = 0;                  // primer token del proximo documento a validar
+size_t registros = 0, registros_malos = 0;
+
+// Valida los documentos ya cerrados (terminados en EOF_TOKEN) y descarta
+// sus tokens y su texto, asi la memoria solo depende del registro mas grande.
+static void validar_documentos() {
+    for (;;) {
+        const void *fin = memchr(tokens.tipo + inicio_doc, EOF_TOKEN, tokens.n - inicio_doc);
+        if (!fin) break;
+        size_t eof = (const unsigned char*)fin - tokens.tipo;
+        current = inicio_doc;
+        registros++;
+        if (!json()) {
+            registros_malos++;
+            printf("Registro %zu (línea %d): errores sintácticos\n", registros, linea_token(inicio_doc));
+        }
+        inicio_doc = eof + 1;
+    }
+    // Compactar solo cuando lo descartable supera a lo que queda: costo amortizado lineal
+    if (inicio_doc == 0 || inicio_doc < tokens.n - inicio_doc) return;
+    // El texto de un token a medias (lex.inicio) tambien queda
+    size_t quedan = tokens.n - inicio_doc;
+    size_t corte = quedan ? tokens.inicio[inicio_doc] : lex.modo != V_NADA ? lex.inicio : fuente_len;
+    memmove(tokens.tipo, tokens.tipo + inicio_doc, quedan);
+    memmove(tokens.inicio, tokens.inicio + inicio_doc, quedan * sizeof(uint32_t));
+    memmove(tokens.largo, tokens.largo + inicio_doc, quedan * sizeof(uint32_t));
+    for (size_t i = 0; i < quedan; i++) tokens.inicio[i] -= (uint32_t)corte;
+    // Los saltos del texto descartado pasan a lineas_descartadas
+    size_t k = saltos_antes(corte);
+    lineas_descartadas += (int)k;
+    saltos_n -= k;
+    for (size_t i = 0; i < saltos_n; i++) saltos[i] = saltos[i + k] - corte;
+    saltos_hasta -= corte;
+    memmove(fuente, fuente + corte, fuente_len - corte);
+    fuente_len -= corte;
+    if (lex.modo != V_NADA) lex.inicio -= corte;
+    tokens.n = quedan;
+    inicio_doc = 0;
+}
+
+static void reportar_stats() { EST(est_reportar(stderr)); }
+
 int main(int argc, char *argv[]) {
-    const char *nombre = (argc > 1) ? argv[1] : "fuente.txt";
-    FILE *entrada = fopen(nombre, "r");
+    const char *nombre = "fuente.txt";
+    const char *cache = NULL;
+    const char *ruta_tokens = NULL;
+    int stats = 0, validar = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stream") == 0) modo_stream = 1;
+        else if (strcmp(argv[i], "--incremental") == 0 && i + 1 < argc) cache = argv[++i];
+        else if (strcmp(argv[i], "--max-depth") == 0 && i + 1 < argc) {
+            long n = strtol(argv[++i], NULL, 10);
+            if (n < 1) {
+                printf("--max-depth debe ser un entero positivo\n");
+                return 1;
+            }
+            max_profundidad = (size_t)n;
+        }
+        else if (strcmp(argv[i], "--stats") == 0) stats = 1;
+        else if (strcmp(argv[i], "--tokens") == 0 && i + 1 < argc) ruta_tokens = argv[++i];
+        else if (strcmp(argv[i], "--validar") == 0) validar = 1;
+        else nombre = argv[i];
+    }
+    if (cache && modo_stream) {
+        printf("--incremental no se combina con --stream\n");
+        return 1;
+    }
+    if (ruta_tokens && (cache || modo_stream)) {
+        printf("--tokens no se combina con --stream ni con --incremental\n");
+        return 1;
+    }
+    if (validar && (cache || modo_stream || ruta_tokens)) {
+        printf("--validar no se combina con --stream, --incremental ni --tokens\n");
+        return 1;
+    }
+    FILE *entrada = strcmp(nombre, "-") == 0 ? stdin : fopen(nombre, "r");
     if (!entrada) {
         printf("No se pudo abrir %s\n", nombre);
         return 1;
     }
 
-    char linea[1024];
-    int numero_linea = 1;
-    while (fgets(linea, sizeof(linea), entrada)) {
-        analizar_linea(linea, numero_linea++);
+    if (stats && !EST_DISPONIBLE) fprintf(stderr, "Aviso: --stats no disponible (compilado con -DSIN_STATS)\n");
+    if (stats && EST_DISPONIBLE) {
+        // El reporte sale al terminar, tambien por exit() en un error
+        est_iniciar("sintactico", nombre, EST_LEER);
+        atexit(reportar_stats);
     }
-    fclose(entrada);
 
-    agregar_token(EOF_TOKEN, "EOF", numero_linea);
+    if (cache) return validar_incremental(nombre, entrada, cache);
+    if (validar) return validar_solo(nombre, entrada);
+
+    if (modo_stream) {
+        // Un registro por vez: se valida apenas se cierra y se descarta
+        size_t n;
+        while ((n = leer_bloque(entrada)) > 0) {
+            lexear(fuente_len - n, fuente_len, 0);
+            EST(est_fase(EST_SINTAXIS));
+            validar_documentos();
+        }
+        if (entrada != stdin) fclose(entrada);
+        lexear(fuente_len, fuente_len, 1);   // el ultimo token puede cerrar un registro
+        validar_documentos();
+        if (tokens.n > inicio_doc) {   // documento sin cerrar al final de la entrada
+            empujar_token(EOF_TOKEN, fin_fuente(lex.salto_final), 0);
+            validar_documentos();
+        }
+        printf("? %zu registro(s) analizado(s) en %s: %zu correcto(s), %zu con errores.\n",
+               registros, nombre, registros - registros_malos, registros_malos);
+        return registros_malos ? 2 : 0;
+    }
+
+    // Los tokens de lexer --tokens se usan solo si se piden: un .tok que
+    // quedo junto a la fuente no cambia lo que se analiza
+    if (ruta_tokens) {
+        if (entrada == stdin || !cargar_flujo(ruta_tokens, nombre)) {
+            printf("%s no es un archivo de tokens vigente para %s\n", ruta_tokens, nombre);
+            return 1;
+        }
+        fclose(entrada);
+    } else {
+        size_t n;
+        while ((n = leer_bloque(entrada)) > 0) lexear(fuente_len - n, fuente_len, 0);
+        if (entrada != stdin) fclose(entrada);
+        lexear(fuente_len, fuente_len, 1);
+
+        agregar_token(EOF_TOKEN, fin_fuente(lex.salto_final), 0);
+    }
 
     printf("Analizando archivo: %s\n", nombre);
 
+    EST(est_fase(EST_SINTAXIS));
     if (json())
         printf("? El archivo %s es sintácticamente correcto.\n", nombre);
     else
@@ -1,160 +1,921 @@
 /* traductor.c - JSON simplificado -> XML
- * Compilar: gcc -Wall -Wextra -O2 traductor.c -o traductor
+ * Compilar: gcc -Wall -Wextra -O2 -pthread traductor.c ../comun/indice.c ../comun/lexico.c ../comun/numero.c ../comun/cinta.c ../comun/columnas.c ../comun/estadisticas.c ../comun/hilos.c -o traductor
  * Uso: traductor.exe fuente.txt   o   traductor.exe archivo.json
+ *      traductor --stream registros.ndjson > salida.xml   (un documento por registro)
+ *      productor | traductor --stream - -o salida.xml
+ *      traductor --max-depth 100000 profundo.json   (limite de anidamiento)
+ *      traductor --canonical-numbers datos.json     (1.50E+2 -> 150)
+ *      traductor --pointer /personas/1/hijos/0/nombre fuente.txt   (solo ese valor)
+ *      traductor --select /personas/0/nombre --select /personas/0/ci fuente.txt   ('*': todos)
+ *      traductor --stats datos.json   (tiempos por fase y contadores en JSON por stderr)
+ *      traductor --batch -j 8 -o salidas/ entrada/   (cada .json/.txt a salidas/<nombre>.xml)
+ *      lento | traductor --pipeline - -o salida.xml   (lectura, traduccion y escritura en paralelo)
+ *      traductor --columnar fuente.txt -o personas.col   (arrays de objetos como tablas por columnas)
+ *      traductor --parallel -j 8 personas.json   (los elementos de los arrays grandes en 8 hilos)
+ *      traductor --serve /tmp/traductor.sock   (residente: pedidos por un socket Unix)
+ *      traductor --client /tmp/traductor.sock datos.json   (un pedido al servidor; XML por stdout)
  */
 
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
+#include <errno.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <dirent.h>
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <poll.h>
+#include <signal.h>
+#endif
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+#include "../comun/indice.h"
+#include "../comun/lexico.h"
+#include "../comun/numero.h"
+#include "../comun/cinta.h"
+#include "../comun/columnas.h"
+#include "../comun/estadisticas.h"
+#include "../comun/hilos.h"
+#include "../comun/anillo.h"
 
 /*======================
   Lexer
 ======================*/
+/* mismos valores que LxTipo (comun/lexico.h) */
 typedef enum {
-    T_LBRACE, T_RBRACE, T_LBRACKET, T_RBRACKET, T_COMMA, T_COLON,
-    T_STRING, T_NUMBER, T_TRUE, T_FALSE, T_NULL,
-    T_EOF, T_ERROR
+    T_LBRACE = LX_LLAVE_A, T_RBRACE = LX_LLAVE_C,
+    T_LBRACKET = LX_CORCHETE_A, T_RBRACKET = LX_CORCHETE_C,
+    T_COMMA = LX_COMA, T_COLON = LX_DOS_PUNTOS,
+    T_STRING = LX_CADENA, T_NUMBER = LX_NUMERO,
+    T_TRUE = LX_TRUE, T_FALSE = LX_FALSE, T_NULL = LX_NULL,
+    T_EOF = LX_FIN, T_ERROR = LX_ERROR
 } TokenType;
 
+/* El lexema es una vista (lex, len) sobre el buffer de entrada; solo se
+ * reescribe en la arena del parser (own) cuando hay secuencias de escape. */
 typedef struct {
     TokenType type;
-    char *lex;      /* para STRING/NUMBER guardamos el lexema */
-    int line;
-    int col;
+    const char *lex;  /* para STRING/NUMBER/palabras clave: vista del lexema */
+    size_t len;
+    char *own;        /* != NULL si lex apunta a la arena */
+    Numero num;       /* NUMBER con sc->numbers: valor convertido (entero o double) */
+    size_t off;       /* posicion en la entrada; linea y columna con sc_posicion */
 } Token;
 
+/* Arena de asignacion por desplazamiento: lexemas reescritos y nombres de
+ * etiqueta viven aca y se liberan en bloque volviendo a una marca. */
+typedef struct ArenaChunk {
+    struct ArenaChunk *next;
+    size_t cap, used;
+    char data[];
+} ArenaChunk;
+
 typedef struct {
-    FILE *f;
+    ArenaChunk *head, *cur;
+    size_t allocs;     /* pedidos servidos sin malloc */
+    size_t grows;      /* crecimientos resueltos en el lugar (sin realloc) */
+    size_t chunks;     /* mallocs reales de bloques */
+    size_t peak;       /* bytes en uso maximos */
+} Arena;
+
+typedef struct { ArenaChunk *chunk; size_t used; } ArenaMark;
+
+typedef struct Etapa Etapa;   /* --pipeline: hilo lector o escritor */
+
+/* El scanner recorre la entrada en memoria: un archivo regular se mapea
+ * completo con mmap; si no (tuberias, stdin, modo --stream, Windows) se lee
+ * en una ventana que se rellena por bloques y solo conserva el token en
+ * curso, asi la memoria no depende del tamano de la entrada. Solo se
+ * lleva la posicion en bytes: la linea y la columna salen del indice de
+ * saltos de linea cuando un mensaje las necesita (sc_posicion). */
+typedef struct {
+    const char *buf;            /* mapeo o ventana */
+    size_t len, pos;            /* bytes validos en buf y posicion actual */
+    size_t base;                /* desplazamiento en la entrada de buf[0] */
+    size_t mark;                /* inicio del token en curso: se conserva al rellenar */
     int ch;
-    int line, col;
+    void *map; size_t map_len;  /* mapeo (mmap) */
+    char *win; size_t cap;      /* ventana cuando no se pudo mapear */
+    int fd, eof;
+    Etapa *tub;                 /* --pipeline: la ventana se llena desde el hilo lector */
+    void (*on_read)(void *ctx); /* se llama antes de una lectura que puede bloquear */
+    void *on_read_ctx;
+    /* indice estructural (comun/indice.h), construido por tramos */
+    IdxEstado ix_st;
+    uint32_t *ix; size_t ix_n, ix_i;  /* posiciones del tramo, relativas a ix_base */
+    size_t ix_base, ix_end;           /* tramo indexado [ix_base, ix_end), en la entrada */
+    Arena *arena;                     /* del parser: lexemas con escapes */
+    int numbers;                      /* convertir los NUMBER a su valor */
+    /* saltos de linea: posiciones de los '\n' de [0, nl_hasta) en orden,
+     * salvo los nl_previos mas viejos, ya fuera de la ventana */
+    size_t *nl; size_t nl_n, nl_cap, nl_hasta;
+    int nl_previos;
 } Scanner;
 
-static void sc_init(Scanner *sc, FILE *f){
-    sc->f = f; sc->ch = fgetc(f);
-    sc->line = 1; sc->col = 1;
-}
-static void sc_advance(Scanner *sc){
-    if (sc->ch == '\n') { sc->line++; sc->col = 1; }
-    else sc->col++;
-    sc->ch = fgetc(sc->f);
-}
+#define IX_TRAMO (1u << 16)
+
 static void *xmalloc(size_t n){
+    EST(est_asignacion(n));
     void *p = malloc(n);
     if(!p){ fprintf(stderr,"Out of memory\n"); exit(1); }
     return p;
 }
+static void *xrealloc(void *p, size_t n){
+    EST(est_asignacion(n));
+    p = realloc(p, n);
+    if(!p){ fprintf(stderr,"Out of memory\n"); exit(1); }
+    return p;
+}
+
+/*--- ARENA ---*/
+#define ARENA_CHUNK (1u << 16)
+
+static void arena_init(Arena *a){
+    a->head = a->cur = NULL;
+    a->allocs = a->grows = a->chunks = a->peak = 0;
+}
+static void arena_free(Arena *a){
+    ArenaChunk *c = a->head;
+    while (c){ ArenaChunk *n = c->next; free(c); c = n; }
+    a->head = a->cur = NULL;
+}
+static size_t arena_in_use(const Arena *a){
+    size_t n = 0;
+    for (const ArenaChunk *c = a->head; c; c = c->next){
+        n += c->used;
+        if (c == a->cur) break;
+    }
+    return n;
+}
+/* deja cur apuntando a un bloque con al menos n bytes libres */
+static void arena_reserve(Arena *a, size_t n){
+    if (a->cur && a->cur->cap - a->cur->used >= n) return;
+    /* los bloques siguientes quedaron libres tras un arena_release */
+    ArenaChunk *nx = a->cur ? a->cur->next : a->head;
+    if (nx && nx->cap >= n){ nx->used = 0; a->cur = nx; return; }
+    size_t cap = n > ARENA_CHUNK ? n : ARENA_CHUNK;
+    ArenaChunk *c = (ArenaChunk*)xmalloc(sizeof(ArenaChunk) + cap);
+    c->cap = cap; c->used = 0;
+    if (a->cur){ c->next = a->cur->next; a->cur->next = c; }
+    else { c->next = a->head; a->head = c; }
+    a->cur = c;
+    a->chunks++;
+}
+static void *arena_alloc(Arena *a, size_t n){
+    n = (n + 7) & ~(size_t)7;
+    arena_reserve(a, n);
+    void *p = a->cur->data + a->cur->used;
+    a->cur->used += n;
+    a->allocs++;
+    return p;
+}
+/* agranda la ultima asignacion en el lugar si entra; si no, la copia */
+static void *arena_grow(Arena *a, void *p, size_t old, size_t n){
+    size_t o = (old + 7) & ~(size_t)7, nn = (n + 7) & ~(size_t)7;
+    ArenaChunk *c = a->cur;
+    if (c && (char*)p + o == c->data + c->used && c->used - o + nn <= c->cap){
+        c->used += nn - o;
+        a->grows++;
+        return p;
+    }
+    void *q = arena_alloc(a, n);
+    memcpy(q, p, old);
+    return q;
+}
+/* devuelve la cola sin usar de la ultima asignacion */
+static void arena_shrink(Arena *a, void *p, size_t old, size_t n){
+    size_t o = (old + 7) & ~(size_t)7, nn = (n + 7) & ~(size_t)7;
+    ArenaChunk *c = a->cur;
+    if (c && (char*)p + o == c->data + c->used) c->used -= o - nn;
+}
+static ArenaMark arena_mark(Arena *a){
+    ArenaMark m; m.chunk = a->cur; m.used = a->cur ? a->cur->used : 0;
+    return m;
+}
+static void arena_release(Arena *a, ArenaMark m){
+    size_t inuse = arena_in_use(a);
+    if (inuse > a->peak) a->peak = inuse;
+    if (m.chunk){ a->cur = m.chunk; a->cur->used = m.used; }
+    else if (a->head){ a->cur = NULL; }
+}
+
+#ifndef WIN_INICIAL
+#define WIN_INICIAL (1u << 16)
+#endif
+
+/*--- TUBERIA (--pipeline) ---*/
+/* Con --pipeline la lectura y la escritura corren en hilos propios y el
+ * parser solo traduce: un lector llena bloques fijos de entrada y un
+ * escritor vacia los de salida, asi la espera de un disco lento o de una
+ * tuberia se superpone con el trabajo del parser. Los bloques van y
+ * vuelven entre las etapas por dos anillos SPSC (comun/anillo.h), llenos
+ * y vacios; como cada anillo tiene lugar para todos los bloques, poner
+ * nunca espera. Un bloque de largo 0 marca el final. */
+#define TUB_BLOQUES 8                /* por etapa (potencia de 2) */
+#define TUB_BLOQUE WIN_INICIAL       /* bloque de entrada: una ventana inicial */
+
+typedef struct { size_t len; char *data; } Bloque;
+
+struct Etapa {
+    int fd;
+    size_t tam;                      /* bytes de cada bloque */
+    int err;                         /* escritor: errno del primer write fallido */
+    int parar;                       /* lector: el parser no quiere mas entrada */
+    Anillo llenos, vacios;
+    void *ranuras[2][TUB_BLOQUES];
+    Bloque bloques[TUB_BLOQUES];
+    Bloque *actual;                  /* del lado del parser: el que consume o llena */
+    size_t usado;
+    Hilo *hilo;
+};
+
+static void etapa_liberar(Etapa *e){
+    for (int i = 0; i < TUB_BLOQUES; i++) free(e->bloques[i].data);
+    free(e);
+}
+/* NULL si no se pudo crear el hilo: se sigue sin tuberia */
+static Etapa *etapa_nueva(int fd, size_t tam, void (*fn)(void *)){
+    Etapa *e = (Etapa*)xmalloc(sizeof *e);
+    e->fd = fd; e->tam = tam; e->err = 0; e->parar = 0;
+    e->actual = NULL; e->usado = 0;
+    anillo_iniciar(&e->llenos, e->ranuras[0], TUB_BLOQUES);
+    anillo_iniciar(&e->vacios, e->ranuras[1], TUB_BLOQUES);
+    for (int i = 0; i < TUB_BLOQUES; i++){
+        e->bloques[i].data = (char*)xmalloc(tam);
+        e->bloques[i].len = 0;
+        anillo_poner(&e->vacios, &e->bloques[i]);
+    }
+    e->hilo = hilo_crear(fn, e);
+    if (!e->hilo){ etapa_liberar(e); return NULL; }
+    return e;
+}
+
+static void lector(void *x){
+    Etapa *e = (Etapa*)x;
+    for (;;){
+        Bloque *b = (Bloque*)anillo_esperar_sacar(&e->vacios);
+        b->len = 0;
+        while (!__atomic_load_n(&e->parar, __ATOMIC_RELAXED)){
+#ifdef _WIN32
+            int n = _read(e->fd, b->data, (unsigned)e->tam);
+#else
+            ssize_t n = read(e->fd, b->data, e->tam);
+#endif
+            if (n < 0 && errno == EINTR) continue;
+            if (n > 0) b->len = (size_t)n;
+            break;
+        }
+        anillo_poner(&e->llenos, b);
+        if (!b->len) return;
+    }
+}
+/* Copia hasta n bytes de lo leido; 0 al final de la entrada. Un token que
+ * cruza de un bloque al siguiente no necesita nada especial: la ventana
+ * del scanner lo conserva entre rellenos. */
+static size_t etapa_leer(Etapa *e, char *dst, size_t n){
+    if (!e->actual){ e->actual = (Bloque*)anillo_esperar_sacar(&e->llenos); e->usado = 0; }
+    Bloque *b = e->actual;
+    if (!b->len) return 0;           /* el bloque final se queda: fin para siempre */
+    size_t k = b->len - e->usado;
+    if (k > n) k = n;
+    memcpy(dst, b->data + e->usado, k);
+    e->usado += k;
+    if (e->usado == b->len){ anillo_poner(&e->vacios, b); e->actual = NULL; }
+    return k;
+}
+/* hay entrada sin esperar */
+static int etapa_lista(Etapa *e){ return e->actual || !anillo_vacio(&e->llenos); }
+/* El parser termino, quizas sin leer todo: el lector para en la proxima
+ * lectura y se descarta lo que ya habia leido. */
+static void etapa_cerrar_lectura(Etapa *e){
+    __atomic_store_n(&e->parar, 1, __ATOMIC_RELAXED);
+    while (!e->actual || e->actual->len){
+        if (e->actual) anillo_poner(&e->vacios, e->actual);
+        e->actual = (Bloque*)anillo_esperar_sacar(&e->llenos);
+    }
+    hilo_esperar(e->hilo);
+    etapa_liberar(e);
+}
+
+static void escritor(void *x){
+    Etapa *e = (Etapa*)x;
+    for (;;){
+        Bloque *b = (Bloque*)anillo_esperar_sacar(&e->llenos);
+        if (!b->len) return;
+        const char *s = b->data;
+        size_t n = b->len;
+        while (n && !e->err){
+#ifdef _WIN32
+            int w = _write(e->fd, s, (unsigned)n);
+#else
+            ssize_t w = write(e->fd, s, n);
+#endif
+            if (w < 0){ if (errno == EINTR) continue; e->err = errno; break; }
+            s += w; n -= (size_t)w;
+        }
+        anillo_poner(&e->vacios, b);
+    }
+}
+
+/*--- POSICIONES ---*/
+/* Agrega al indice los saltos de [nl_hasta, hasta), que estan en buf */
+static void sc_indexar(Scanner *sc, size_t hasta){
+    if (hasta <= sc->nl_hasta) return;
+    const char *p = sc->buf + (sc->nl_hasta - sc->base), *end = sc->buf + (hasta - sc->base), *q;
+    while ((q = (const char*)memchr(p, '\n', (size_t)(end - p))) != NULL){
+        if (sc->nl_n == sc->nl_cap){
+            sc->nl_cap = sc->nl_cap ? sc->nl_cap * 2 : 1024;
+            sc->nl = (size_t*)xrealloc(sc->nl, sc->nl_cap * sizeof *sc->nl);
+        }
+        sc->nl[sc->nl_n++] = sc->base + (size_t)(q - sc->buf);
+        p = q + 1;
+    }
+    sc->nl_hasta = hasta;
+}
+/* cuantos saltos del indice estan antes de off (busqueda binaria) */
+static size_t sc_saltos_antes(const Scanner *sc, size_t off){
+    size_t a = 0, b = sc->nl_n;
+    while (a < b){
+        size_t m = a + (b - a) / 2;
+        if (sc->nl[m] < off) a = m + 1; else b = m;
+    }
+    return a;
+}
+/* Linea y columna (desde 1; la columna en bytes) de la posicion off, que
+ * sigue en la ventana. Solo para mensajes: el resto del scanner no las usa. */
+static void sc_posicion(Scanner *sc, size_t off, int *line, int *col){
+    sc_indexar(sc, off);
+    size_t k = sc_saltos_antes(sc, off);
+    *line = sc->nl_previos + (int)k + 1;
+    *col = (int)(off - (k ? sc->nl[k-1] + 1 : 0)) + 1;
+}
+/* Antes de descartar [base, hasta) de la ventana: sus saltos se cuentan y
+ * del indice queda solo el ultimo, para la columna de lo que sigue. */
+static void sc_olvidar(Scanner *sc, size_t hasta){
+    sc_indexar(sc, hasta);
+    size_t k = sc_saltos_antes(sc, hasta);
+    if (k < 2) return;
+    sc->nl_previos += (int)(k - 1);
+    memmove(sc->nl, sc->nl + k - 1, (sc->nl_n - (k - 1)) * sizeof *sc->nl);
+    sc->nl_n -= k - 1;
+}
+
+/* Rellena la ventana: descarta lo anterior a la marca, agranda si un token
+ * ocupa la ventana entera y lee lo que haya disponible. Devuelve el nuevo ch. */
+static int sc_fill(Scanner *sc){
+    if (!sc->win || sc->eof) return EOF;
+    size_t keep = sc->mark < sc->len ? sc->mark : sc->len;
+    if (keep){
+        sc_olvidar(sc, sc->base + keep);
+        memmove(sc->win, sc->win + keep, sc->len - keep);
+        sc->len -= keep; sc->pos -= keep; sc->mark -= keep; sc->base += keep;
+    }
+    if (sc->len == sc->cap){
+        sc->cap *= 2;
+        sc->win = (char*)xrealloc(sc->win, sc->cap);
+    }
+    sc->buf = sc->win;
+    if (sc->on_read && !(sc->tub && etapa_lista(sc->tub))) sc->on_read(sc->on_read_ctx);
+    EST(est_entrar(EST_LEER));
+    if (sc->tub){
+        size_t n = etapa_leer(sc->tub, sc->win + sc->len, sc->cap - sc->len);
+        if (!n) sc->eof = 1;
+        sc->len += n;
+        EST(est.bytes_entrada += n);
+    } else for (;;){
+#ifdef _WIN32
+        int n = _read(sc->fd, sc->win + sc->len, (unsigned)(sc->cap - sc->len));
+#else
+        ssize_t n = read(sc->fd, sc->win + sc->len, sc->cap - sc->len);
+#endif
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0){ sc->eof = 1; break; }
+        sc->len += (size_t)n;
+        EST(est.bytes_entrada += (size_t)n);
+        break;
+    }
+    EST(est_volver());
+    return sc->pos < sc->len ? (unsigned char)sc->buf[sc->pos] : EOF;
+}
+
+/* no_map: leer por ventana aunque la entrada sea un archivo regular */
+static void sc_init(Scanner *sc, FILE *f, int no_map){
+    sc->buf = NULL; sc->len = 0; sc->pos = 0; sc->base = 0; sc->mark = 0;
+    sc->map = NULL; sc->map_len = 0; sc->win = NULL; sc->cap = 0;
+    sc->fd = fileno(f); sc->eof = 0; sc->tub = NULL;
+    sc->on_read = NULL; sc->on_read_ctx = NULL;
+    sc->numbers = 0;
+#ifndef _WIN32
+    struct stat st;
+    if (!no_map && fstat(sc->fd, &st)==0 && S_ISREG(st.st_mode) && st.st_size > 0){
+        void *m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, sc->fd, 0);
+        if (m != MAP_FAILED){
+#ifdef MADV_SEQUENTIAL
+            madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+            sc->map = m; sc->map_len = (size_t)st.st_size;
+            sc->buf = (const char*)m; sc->len = sc->map_len;
+            EST(est.bytes_entrada = sc->map_len);
+        }
+    }
+#else
+    (void)no_map;
+#endif
+    sc->nl = NULL; sc->nl_n = sc->nl_cap = sc->nl_hasta = 0; sc->nl_previos = 0;
+    idx_iniciar(&sc->ix_st);
+    sc->ix = (uint32_t*)xmalloc(IX_TRAMO * sizeof *sc->ix);
+    sc->ix_n = sc->ix_i = 0;
+    sc->ix_base = sc->ix_end = 0;
+    if (sc->map){
+        sc->ch = (unsigned char)sc->buf[0];
+    } else {
+        sc->cap = WIN_INICIAL;
+        sc->win = (char*)xmalloc(sc->cap);
+        sc->buf = sc->win;
+        sc->ch = EOF;   /* la primera lectura se hace en sc_start */
+    }
+}
+/* El scanner de sc_rango sobre otro texto en memoria, s[0..n); el indice
+ * y los saltos reusan lo ya reservado (--serve, un pedido tras otro) */
+static void sc_reusar(Scanner *sc, const char *s, size_t n){
+    sc->buf = s; sc->len = n; sc->pos = 0; sc->base = 0; sc->mark = 0;
+    sc->nl_n = sc->nl_hasta = 0; sc->nl_previos = 0;
+    idx_iniciar(&sc->ix_st);
+    sc->ix_n = sc->ix_i = 0;
+    sc->ix_base = sc->ix_end = 0;
+    sc->ch = n ? (unsigned char)s[0] : EOF;
+}
+/* --parallel: el tramo s[0..n) de una entrada ya mapeada, sin ventana */
+static void sc_rango(Scanner *sc, const char *s, size_t n){
+    sc->map = NULL; sc->map_len = 0; sc->win = NULL; sc->cap = 0;
+    sc->fd = -1; sc->eof = 1; sc->tub = NULL;
+    sc->on_read = NULL; sc->on_read_ctx = NULL;
+    sc->numbers = 0;
+    sc->nl = NULL; sc->nl_cap = 0;
+    sc->ix = (uint32_t*)xmalloc(IX_TRAMO * sizeof *sc->ix);
+    sc_reusar(sc, s, n);
+}
+/* primera lectura (separada de sc_init para poder instalar on_read antes) */
+static void sc_start(Scanner *sc){
+    if (sc->win) sc->ch = sc_fill(sc);
+}
+static void sc_close(Scanner *sc){
+    if (sc->tub) etapa_cerrar_lectura(sc->tub);
+    sc->tub = NULL;
+#ifndef _WIN32
+    if (sc->map) munmap(sc->map, sc->map_len);
+#endif
+    free(sc->win);
+    free(sc->ix);
+    free(sc->nl);
+    sc->map = NULL; sc->win = NULL; sc->buf = NULL; sc->ix = NULL; sc->nl = NULL;
+}
+static void sc_advance(Scanner *sc){
+    if (++sc->pos < sc->len) sc->ch = (unsigned char)sc->buf[sc->pos];
+    else sc->ch = sc_fill(sc);
+}
+/* Primera posicion del indice estructural >= pos, en la ventana. Si no
+ * hay ninguna en lo ya leido devuelve hasta donde se sabe que hay blancos. */
+static size_t sc_next_structural(Scanner *sc){
+    size_t at = sc->base + sc->pos;
+    for (;;){
+        while (sc->ix_i < sc->ix_n){
+            size_t q = sc->ix_base + sc->ix[sc->ix_i];
+            if (q >= at) return q - sc->base;
+            sc->ix_i++;
+        }
+        /* El lexer dejo atras lo indexado (una cadena larga, un token
+         * erroneo): en un blanco fuera de cadena el indice puede empezar
+         * de nuevo desde aca. */
+        if (sc->ix_end < at){ idx_iniciar(&sc->ix_st); sc->ix_end = at; }
+        size_t from = sc->ix_end - sc->base;
+        if (from >= sc->len) return sc->len;
+        size_t n = sc->len - from;
+        if (n > IX_TRAMO) n = IX_TRAMO;
+        if (sc->win && !sc->eof){          /* tramos completos mientras no sea el final */
+            n -= n % IDX_BLOQUE;
+            if (!n) return from;
+        }
+        sc->ix_base = sc->ix_end;
+        EST(est_entrar(EST_LEXICO));
+        sc->ix_n = idx_tramo(&sc->ix_st, sc->buf + from, n, sc->ix);
+        EST(est_volver());
+        sc->ix_i = 0;
+        sc->ix_end += n;
+    }
+}
+/* avanza k bytes */
+static void sc_skip(Scanner *sc, size_t k){
+    sc->pos += k;
+    sc->ch = sc->pos < sc->len ? (unsigned char)sc->buf[sc->pos] : sc_fill(sc);
+}
+/* salta hasta q */
+static void sc_jump(Scanner *sc, size_t q){
+    sc->pos = q;
+    sc->ch = q < sc->len ? (unsigned char)sc->buf[q] : sc_fill(sc);
+}
+#define IS_WS(c) ((c)==' ' || (c)=='\t' || (c)=='\r' || (c)=='\n')
 static void skip_ws(Scanner *sc){
-    while (sc->ch==' ' || sc->ch=='\t' || sc->ch=='\r' || sc->ch=='\n') sc_advance(sc);
+    /* un blanco suelto se salta directo; las corridas largas (sangria) con el indice */
+    if (!IS_WS(sc->ch)) return;
+    sc_advance(sc);
+    while (IS_WS(sc->ch)){
+        size_t q = sc_next_structural(sc);
+        if (q == sc->pos) break;
+        sc_jump(sc, q);
+    }
+    while (IS_WS(sc->ch)) sc_advance(sc);
+}
+
+/* Salta sin armar tokens: con depth 0 el valor que empieza en pos (tras
+ * blancos), con depth > 0 el resto de los contenedores ya abiertos. El
+ * indice estructural ya sabe donde estan las cadenas, asi que alcanza con
+ * contar llaves y corchetes; lo salteado no se valida. Queda en el byte
+ * que sigue al valor (o en el delimitador si no habia ninguno). */
+static void sc_skip_value(Scanner *sc, size_t depth){
+    int seen = depth > 0;
+    for (;;){
+        sc->mark = sc->pos;            /* al rellenar no se conserva lo salteado */
+        size_t q = sc_next_structural(sc);
+        if (q >= sc->len || q + sc->base >= sc->ix_end){
+            /* nada indexado en lo leido: leer mas o terminar */
+            if (q >= sc->len){
+                sc_jump(sc, sc->len);
+                if (sc->ch == EOF) return;
+            } else sc->ch = sc_fill(sc);
+            continue;
+        }
+        unsigned char c = (unsigned char)sc->buf[q];
+        if (c == '{' || c == '['){ depth++; seen = 1; }
+        else if (c == '}' || c == ']'){
+            if (!depth){ sc_jump(sc, q); return; }
+            if (!--depth){ sc_jump(sc, q + 1); return; }
+        }
+        else if (c == ',' || c == ':'){ if (!depth){ sc_jump(sc, q); return; } }
+        else if (!depth){              /* cadena o escalar suelto */
+            if (seen){ sc_jump(sc, q); return; }
+            seen = 1;
+        }
+        sc_jump(sc, q + 1);
+    }
 }
-static int is_num_start(int c){ return isdigit(c); }
 
-static Token make_simple(TokenType t, int line, int col){
-    Token tk; tk.type=t; tk.lex=NULL; tk.line=line; tk.col=col; return tk;
+static Token make_simple(TokenType t, size_t off){
+    Token tk; tk.type=t; tk.lex=NULL; tk.len=0; tk.own=NULL; tk.off=off; return tk;
+}
+static Token make_view(TokenType t, const char *s, size_t n, size_t off){
+    Token tk; tk.type=t; tk.lex=s; tk.len=n; tk.own=NULL; tk.off=off; return tk;
 }
 
 /*--- STRING ---*/
+/* Sin escapes el lexema es una vista directa del buffer. Al primer '\\'
+ * se copia lo leido hasta ahi y se sigue decodificando en memoria propia
+ * (lx_escape: todos los escapes de JSON, \\uXXXX en UTF-8). Los tramos
+ * entre escapes se buscan de a bloques con lx_cadena. Un escape invalido
+ * da un token de error, pero la cadena se lee igual hasta su comilla. */
 static Token lex_string(Scanner *sc){
-    int line = sc->line, col = sc->col;
+    size_t off = sc->base + sc->pos;
     sc_advance(sc);
+    /* posiciones siempre relativas a mark: la ventana puede correrse */
     char *buf = NULL; size_t cap=0, len=0;
-    #define PUSH(c) do{ if(len+1>=cap){ cap=cap?cap*2:64; buf=realloc(buf,cap); if(!buf){fprintf(stderr,"OOM\n");exit(1);} } buf[len++]=(char)(c); }while(0)
-    int closed = 0;
+    #define RESERVE(n) do{ while(len+(n)>=cap){ buf=(char*)arena_grow(sc->arena,buf,cap,cap*2); cap*=2; } }while(0)
+    int closed = 0, bad = 0;
     while (sc->ch != EOF){
-        if (sc->ch == '"'){ sc_advance(sc); closed=1; break; }
-        if (sc->ch == '\\'){
-            sc_advance(sc);
-            if (sc->ch==EOF) break;
-            int out = sc->ch;
-            if (out=='n') out='\n';
-            else if (out=='t') out='\t';
-            else if (out=='r') out='\r';
-            PUSH(out);
-            sc_advance(sc);
-        } else {
-            PUSH(sc->ch);
-            sc_advance(sc);
+        size_t k = lx_cadena(sc->buf + sc->pos, sc->len - sc->pos);
+        if (buf && k){ RESERVE(k); memcpy(buf+len, sc->buf + sc->pos, k); len += k; }
+        sc_jump(sc, sc->pos + k);   /* al final de la ventana rellena */
+        if (sc->ch == '"'){ closed=1; break; }
+        if (sc->ch != '\\') continue;
+        if (!buf){
+            size_t n = sc->pos - (sc->mark + 1);
+            cap = n + 64; buf = (char*)arena_alloc(sc->arena, cap);
+            memcpy(buf, sc->buf + sc->mark + 1, n); len = n;
         }
+        /* el escape entero en la ventana (mark la retiene al rellenar) */
+        while (sc->len - sc->pos < LX_ESCAPE_MAX && sc->win && !sc->eof) sc_fill(sc);
+        RESERVE(4);
+        size_t out;
+        size_t used = lx_escape(sc->buf + sc->pos, sc->len - sc->pos, buf + len, &out);
+        if (used){ len += out; sc_skip(sc, used); continue; }
+        bad = 1;   /* se saltea la barra y el byte que le sigue */
+        sc_advance(sc);
+        if (sc->ch != EOF) sc_advance(sc);
     }
-    PUSH('\0');
+    #undef RESERVE
     Token tk;
     if (!closed){
-        tk.type=T_ERROR; tk.lex=strdup("Unterminated string"); tk.line=line; tk.col=col;
-    } else {
-        tk.type=T_STRING; tk.lex=buf; tk.line=line; tk.col=col;
+        if (buf) arena_shrink(sc->arena, buf, cap, 0);
+        return make_view(T_ERROR, "Unterminated string", 19, off);
     }
-    return tk;
-}
-
-/*--- NUMBER ---*/
-static Token lex_number(Scanner *sc){
-    int line=sc->line, col=sc->col;
-    char tmp[256]; size_t n=0;
-    while (isdigit(sc->ch)){ if(n<255) tmp[n++]=(char)sc->ch; sc_advance(sc); }
-    if (sc->ch=='.'){ if(n<255) tmp[n++]='.'; sc_advance(sc);
-        while (isdigit(sc->ch)){ if(n<255) tmp[n++]=(char)sc->ch; sc_advance(sc); }
+    sc_advance(sc);   /* comilla de cierre */
+    if (bad){
+        arena_shrink(sc->arena, buf, cap, 0);
+        return make_view(T_ERROR, "Invalid escape in string", 24, off);
     }
-    if (sc->ch=='e' || sc->ch=='E'){
-        if(n<255) tmp[n++]=(char)sc->ch; sc_advance(sc);
-        if (sc->ch=='+' || sc->ch=='-'){ if(n<255) tmp[n++]=(char)sc->ch; sc_advance(sc); }
-        while (isdigit(sc->ch)){ if(n<255) tmp[n++]=(char)sc->ch; sc_advance(sc); }
+    if (buf){
+        buf[len] = '\0';
+        arena_shrink(sc->arena, buf, cap, len+1);
+        tk = make_view(T_STRING, buf, len, off);
+        tk.own = buf;
+    } else {
+        tk = make_view(T_STRING, sc->buf + sc->mark + 1, sc->pos - sc->mark - 2, off);
     }
-    tmp[n]='\0';
-    Token tk; tk.type=T_NUMBER; tk.lex=strdup(tmp); tk.line=line; tk.col=col; return tk;
+    return tk;
 }
 
-/*--- PALABRAS CLAVE ---*/
-static int match_kw(const char *s, const char *kw){
-    for(; *s && *kw; ++s,++kw){
-        if (tolower((unsigned char)*s) != tolower((unsigned char)*kw)) return 0;
+/*--- NUMEROS Y PALABRAS CLAVE ---*/
+/* La corrida hasta el proximo delimitador pasa por el AFD comun: numero,
+ * true/false/null o, si no es ninguno, un unico token de error. Si alguna
+ * opcion usa el valor, los numeros salen convertidos (comun/numero.h). */
+static Token lex_scalar(Scanner *sc){
+    size_t off = sc->base + sc->pos;
+    unsigned char e = LXA_INICIO;
+    for (;;){
+        size_t n = sc->len - sc->pos;
+        size_t k = lx_escalar(&e, sc->buf + sc->pos, n);
+        sc_skip(sc, k);
+        if (k < n || sc->ch == EOF) break;
     }
-    return *s=='\0' && *kw=='\0';
+    const char *s = sc->buf + sc->mark;
+    size_t n = sc->pos - sc->mark;
+    Token tk = make_view((TokenType)lx_fin_escalar(e, s, n), s, n, off);
+    if (tk.type == T_NUMBER && sc->numbers) num_leer(s, n, &tk.num);
+    return tk;
 }
 
 /*--- TOKENIZER PRINCIPAL ---*/
+static Token scan_token(Scanner *sc);
+/* El indice asume las reglas de cadenas del lexer; tras un token erroneo
+ * (p.ej. una '\\' fuera de cadena) puede desincronizarse: se descarta y se
+ * reconstruye desde el proximo blanco. */
 static Token next_token(Scanner *sc){
+    EST(est_fase(EST_LEXICO));
+    Token tk = scan_token(sc);
+    EST(est_fase(EST_SINTAXIS); est_token(tk.type));
+    if (tk.type == T_ERROR){ sc->ix_n = sc->ix_i = 0; sc->ix_end = 0; }
+    return tk;
+}
+static Token scan_token(Scanner *sc){
+    sc->mark = sc->pos;   /* el token anterior ya no se usa */
     skip_ws(sc);
-    int line=sc->line, col=sc->col;
-    if (sc->ch==EOF) return make_simple(T_EOF, line, col);
-    int c = sc->ch;
-    switch (c){
-        case '{': sc_advance(sc); return make_simple(T_LBRACE,line,col);
-        case '}': sc_advance(sc); return make_simple(T_RBRACE,line,col);
-        case '[': sc_advance(sc); return make_simple(T_LBRACKET,line,col);
-        case ']': sc_advance(sc); return make_simple(T_RBRACKET,line,col);
-        case ',': sc_advance(sc); return make_simple(T_COMMA,line,col);
-        case ':': sc_advance(sc); return make_simple(T_COLON,line,col);
-        case '"': return lex_string(sc);
-        default:
-            if (is_num_start(c)) return lex_number(sc);
-            if (isalpha(c)){
-                char buf[16]; size_t n=0;
-                while (isalpha(sc->ch) && n<15){ buf[n++]=(char)sc->ch; sc_advance(sc); }
-                buf[n]='\0';
-                Token tk; tk.lex=strdup(buf); tk.line=line; tk.col=col;
-                if (match_kw(buf,"true"))  { tk.type=T_TRUE;  return tk; }
-                if (match_kw(buf,"false")) { tk.type=T_FALSE; return tk; }
-                if (match_kw(buf,"null"))  { tk.type=T_NULL;  return tk; }
-                tk.type=T_ERROR; return tk;
-            }
-            sc_advance(sc);
-            Token tk; tk.type=T_ERROR; tk.lex=strdup("BadChar"); tk.line=line; tk.col=col; return tk;
+    sc->mark = sc->pos;
+    size_t off = sc->base + sc->pos;
+    if (sc->ch==EOF) return make_simple(T_EOF, off);
+    int c = lx_clase[sc->ch];
+    if (c <= LXC_DOS_PUNTOS){ sc_advance(sc); return make_simple((TokenType)c, off); }
+    if (c == LXC_COMILLA) return lex_string(sc);
+    return lex_scalar(sc);
+}
+
+/*======================
+  Salida XML
+======================*/
+/* Buffer de salida propio: se acumula en memoria y se vuelca con write()
+ * en bloques grandes; los textos mas grandes que el buffer van directo
+ * con writev() junto con lo pendiente. Con --pipeline el buffer es un
+ * bloque de la etapa escritora y volcar es pasarlo al hilo escritor. */
+#define OUT_CAP (1u << 18)
+
+typedef struct {
+    int fd;
+    char *buf;
+    size_t len;
+    int err;        /* errno del primer write fallido */
+    Etapa *tub;     /* --pipeline: hilo escritor */
+    char *mem;      /* fd < 0 (obreros de --parallel): lo volcado queda aca */
+    size_t mem_len, mem_cap;
+} OutBuf;
+
+static void ob_init(OutBuf *ob, int fd){
+    ob->fd = fd; ob->buf = (char*)xmalloc(OUT_CAP); ob->len = 0; ob->err = 0;
+    ob->tub = NULL;
+    ob->mem = NULL; ob->mem_len = ob->mem_cap = 0;
+}
+/* fd < 0: volcar es agregar a mem */
+static void ob_guardar(OutBuf *ob, const char *s, size_t n){
+    if (ob->mem_len + n > ob->mem_cap){
+        size_t cap = ob->mem_cap ? ob->mem_cap : OUT_CAP;
+        while (cap < ob->mem_len + n) cap *= 2;
+        ob->mem = (char*)xrealloc(ob->mem, cap);
+        ob->mem_cap = cap;
     }
+    memcpy(ob->mem + ob->mem_len, s, n);
+    ob->mem_len += n;
+}
+/* --pipeline: las escrituras pasan al hilo escritor */
+static void ob_tuberia(OutBuf *ob){
+    Etapa *e = etapa_nueva(ob->fd, OUT_CAP, escritor);
+    if (!e) return;
+    e->actual = (Bloque*)anillo_sacar(&e->vacios);
+    free(ob->buf);
+    ob->buf = e->actual->data;
+    ob->tub = e;
+}
+/* el bloque lleno va al escritor y se toma uno vacio */
+static void ob_pasar(OutBuf *ob){
+    Etapa *e = ob->tub;
+    if (!ob->len) return;
+    EST(est_entrar(EST_SALIDA); est.bytes_salida += ob->len);
+    e->actual->len = ob->len;
+    anillo_poner(&e->llenos, e->actual);
+    e->actual = (Bloque*)anillo_esperar_sacar(&e->vacios);
+    EST(est_volver());
+    ob->buf = e->actual->data;
+    ob->len = 0;
+}
+static void write_all(OutBuf *ob, const char *s, size_t n){
+    EST(est_entrar(EST_SALIDA); est.bytes_salida += n);
+    while (n && !ob->err){
+#ifdef _WIN32
+        int w = _write(ob->fd, s, n > 0x40000000u ? 0x40000000u : (unsigned)n);
+#else
+        ssize_t w = write(ob->fd, s, n);
+#endif
+        if (w < 0){ if (errno == EINTR) continue; ob->err = errno; break; }
+        s += w; n -= (size_t)w;
+    }
+    EST(est_volver());
+}
+static void ob_flush(OutBuf *ob){
+    if (ob->tub){ ob_pasar(ob); return; }
+    if (ob->fd < 0){ ob_guardar(ob, ob->buf, ob->len); ob->len = 0; return; }
+    write_all(ob, ob->buf, ob->len);
+    ob->len = 0;
+}
+static void ob_free(OutBuf *ob){
+    ob_flush(ob);
+    if (ob->tub){
+        Etapa *e = ob->tub;
+        e->actual->len = 0;                  /* fin para el escritor */
+        anillo_poner(&e->llenos, e->actual);
+        hilo_esperar(e->hilo);
+        if (!ob->err) ob->err = e->err;
+        etapa_liberar(e);
+        ob->tub = NULL; ob->buf = NULL;
+        return;
+    }
+    free(ob->buf); ob->buf = NULL;
+}
+/* vuelca lo pendiente y s en una sola llamada */
+static void ob_write_through(OutBuf *ob, const char *s, size_t n){
+    if (ob->fd < 0){ ob_flush(ob); ob_guardar(ob, s, n); return; }
+    if (ob->tub){                            /* en bloques, para el escritor */
+        while (n){
+            size_t k = OUT_CAP - ob->len;
+            if (k > n) k = n;
+            memcpy(ob->buf + ob->len, s, k);
+            ob->len += k; s += k; n -= k;
+            if (ob->len == OUT_CAP) ob_pasar(ob);
+        }
+        return;
+    }
+#ifdef _WIN32
+    ob_flush(ob);
+    write_all(ob, s, n);
+#else
+    struct iovec iov[2];
+    iov[0].iov_base = ob->buf; iov[0].iov_len = ob->len;
+    iov[1].iov_base = (void*)s; iov[1].iov_len = n;
+    ssize_t w;
+    EST(est_entrar(EST_SALIDA));
+    do w = writev(ob->fd, iov, 2); while (w < 0 && errno == EINTR);
+    EST(est_volver(); est.bytes_salida += w > 0 ? (size_t)w : 0);
+    if (w < 0){ ob->err = errno; ob->len = 0; return; }
+    size_t done = (size_t)w;
+    if (done < ob->len){                  /* escritura parcial: completar */
+        write_all(ob, ob->buf + done, ob->len - done);
+        write_all(ob, s, n);
+    } else {
+        done -= ob->len;
+        write_all(ob, s + done, n - done);
+    }
+    ob->len = 0;
+#endif
+}
+static inline void ob_put(OutBuf *ob, const char *s, size_t n){
+    if (ob->len + n > OUT_CAP){
+        if (n >= OUT_CAP){ ob_write_through(ob, s, n); return; }
+        ob_flush(ob);
+    }
+    memcpy(ob->buf + ob->len, s, n);
+    ob->len += n;
+}
+/* primer '&', '<' o '>' en s[0..n) (n si no hay) */
+static size_t find_special(const char *s, size_t n){
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i amp = _mm_set1_epi8('&'), lt = _mm_set1_epi8('<'), gt = _mm_set1_epi8('>');
+    for (; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        __m128i m = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, amp), _mm_cmpeq_epi8(v, lt)),
+                                 _mm_cmpeq_epi8(v, gt));
+        int bits = _mm_movemask_epi8(m);
+        if (bits) return i + (size_t)__builtin_ctz((unsigned)bits);
+    }
+#endif
+    for (; i < n; i++)
+        if (s[i]=='&' || s[i]=='<' || s[i]=='>') return i;
+    return n;
 }
 
 /*======================
   Parser + XML
 ======================*/
+/* Clave de objeto con sus etiquetas ya armadas: "<tag></tag>" en un solo
+ * bloque, open = tags[0..olen) y close = tags[olen..olen+clen). */
+typedef struct {
+    const char *key; size_t klen;   /* lexema de la clave (ya decodificado) */
+    uint32_t hash;
+    uint32_t id;                    /* orden de aparicion; estable */
+    const char *tags;
+    size_t olen, clen;
+} Clave;
+
+/* Tabla de claves internadas (direccionamiento abierto). Cada clave
+ * distinta se sanea y se arma una sola vez; repetirla cuesta un hash y dos
+ * memcpy. Con mas de CLAVES_MAX claves distintas (p.ej. claves que son
+ * ids) las nuevas ya no se guardan y se arman en la arena del parser. */
+#define CLAVES_MAX (1u << 16)
+typedef struct {
+    Clave **slots;
+    size_t cap, n;
+    size_t lookups, hits;
+    Arena mem;        /* claves y etiquetas: viven hasta el final */
+} TablaClaves;
+
+/* Proyeccion (--select): rutas al estilo JSON Pointer donde el segmento
+ * "*" es cualquier clave o indice. La seleccion de un valor es el
+ * conjunto de patrones que todavia pueden coincidir debajo de el (un bit
+ * por patron), o SEL_TODO si alguno ya coincidio entero. */
+#define SEL_MAX 63
+#define SEL_TODO (1ULL << 63)
+typedef struct {
+    char *s; size_t n;   /* sin escapes (~0 ~1) */
+    long long idx;       /* como indice de array; -1 si no es un numero */
+    int any;             /* "*" */
+} Segmento;
+typedef struct {
+    Segmento *seg[SEL_MAX];
+    size_t nseg[SEL_MAX];
+    size_t n;
+    uint64_t raiz;       /* seleccion del documento */
+} Filtro;
+
+/* Pila explicita del parser: un marco por cada objeto/array abierto */
+typedef enum { F_OBJECT, F_ARRAY } FrameKind;
+typedef struct {
+    FrameKind kind;
+    const Clave *key;  /* etiqueta a cerrar (NULL si no se abrio) */
+    ArenaMark mark;    /* la arena vuelve aca tras cada atributo/elemento */
+    uint64_t sel;      /* --select: seleccion de este contenedor */
+    size_t index;      /* --select: indice del elemento actual del array */
+    int item;          /* --select: hay un <item> abierto */
+} Frame;
+
+#define MAX_DEPTH_DEF 10000
+#define COL_MUESTRA 100     /* --columnar: filas de muestra por tabla */
+
 typedef struct {
     Scanner sc;
     Token la;      /* lookahead */
-    FILE *out;
+    OutBuf *out;
     int errors;
+    size_t records;  /* documentos traducidos en modo --stream */
+    Frame *stack;
+    size_t depth, cap;
+    size_t max_depth;
+    int canonical;   /* --canonical-numbers: numeros en forma canonica */
+    Cinta *tape;     /* --tape/--pointer: se arma la cinta y se traduce desde ella */
+    const Filtro *filtro;   /* --select (NULL: todo el documento) */
+    const char *pointer;
+    size_t columnar;      /* --columnar: filas de muestra del esquema (0: XML) */
+    size_t paralelo;      /* --parallel: hilos para los arrays grandes (0: no) */
+    int mudo;             /* obrero de --parallel: los errores solo se cuentan */
+    const char *nombre;   /* --batch: archivo al frente de cada mensaje (NULL: nada) */
+    OutBuf *diag;         /* --serve: los mensajes van a la respuesta (NULL: stderr) */
+    TablaClaves claves;
+    Arena arena;   /* lexemas con escapes y claves no internadas; se vuelve a una
+                      marca tras cada atributo de un objeto y cada elemento de un array */
 } Parser;
 
 /* utilidades */
-static void token_free(Token *t){ if (t->lex) free(t->lex); t->lex=NULL; }
+/* la memoria de own es de la arena: se recupera en arena_release */
+static void token_free(Token *t){ t->own=NULL; t->lex=NULL; t->len=0; }
 static void advance(Parser *p){ token_free(&p->la); p->la = next_token(&p->sc); }
+/* Vuelve la arena a la marca tomada al entrar al objeto/array. Solo es
+ * seguro si el lookahead no vive en ella (lo normal: ',', '}' o ']'). */
+static void arena_reset_to(Parser *p, ArenaMark m){
+    if (!p->la.own) arena_release(&p->arena, m);
+}
 static const char* tname(TokenType t){
     switch(t){
         case T_LBRACE: return "'{'";
@@ -172,10 +933,25 @@ static const char* tname(TokenType t){
         default:       return "token";
     }
 }
+/* Un mensaje ya armado sale en un solo fprintf: con --batch varios hilos
+ * escriben en stderr a la vez. Con --serve va a la respuesta del pedido. */
+static void mensaje(Parser *p, const char *linea){
+    if (!p->diag){ fprintf(stderr, "%s\n", linea); return; }
+    ob_put(p->diag, linea, strlen(linea));
+    ob_put(p->diag, "\n", 1);
+}
 static void report(Parser *p, const char* msg, const char* expect){
-    fprintf(stderr,"[Linea %d, Col %d] %s", p->la.line, p->la.col, msg);
-    if (expect) fprintf(stderr, " (esperaba %s, encontro %s)", expect, tname(p->la.type));
-    fprintf(stderr,"\n");
+    if (p->mudo){ p->errors++; return; }
+    char linea[512];
+    int line, col;
+    sc_posicion(&p->sc, p->la.off, &line, &col);
+    int n = snprintf(linea, sizeof linea, "%s%s[Linea %d, Col %d] %s",
+                     p->nombre ? p->nombre : "", p->nombre ? ": " : "",
+                     line, col, msg);
+    if (expect && n >= 0 && (size_t)n < sizeof linea)
+        snprintf(linea + n, sizeof linea - (size_t)n, " (esperaba %s, encontro %s)",
+                 expect, tname(p->la.type));
+    mensaje(p, linea);
     p->errors++;
 }
 
@@ -187,27 +963,92 @@ static int stop_attr(TokenType t){ return t==T_COMMA || t==T_RBRACE || t==T_EOF;
 static int stop_elem(TokenType t){ return t==T_COMMA || t==T_RBRACKET || t==T_EOF; }
 
 /* XML helpers */
-static void xml_text(FILE *f, const char *s){
-    for (; *s; ++s){
-        if (*s=='&') fputs("&amp;", f);
-        else if (*s=='<') fputs("&lt;", f);
-        else if (*s=='>') fputs("&gt;", f);
-        else fputc(*s, f);
+/* copia en bloque los tramos sin caracteres a escapar */
+static void xml_text(OutBuf *ob, const char *s, size_t n){
+    for (;;){
+        size_t k = find_special(s, n);
+        ob_put(ob, s, k);
+        if (k == n) return;
+        if (s[k]=='&') ob_put(ob, "&amp;", 5);
+        else if (s[k]=='<') ob_put(ob, "&lt;", 4);
+        else ob_put(ob, "&gt;", 4);
+        s += k + 1; n -= k + 1;
+    }
+}
+/*--- CLAVES ---*/
+static const Clave clave_value = { "value", 5, 0, 0, "<value></value>", 7, 8 };
+
+static uint32_t clave_hash(const char *s, size_t n){
+    uint32_t h = 2166136261u;                    /* FNV-1a */
+    for (size_t i = 0; i < n; i++){ h ^= (unsigned char)s[i]; h *= 16777619u; }
+    return h;
+}
+
+/* Arma la clave en la arena a: la etiqueta es el lexema hasta el primer
+ * '\0' con los espacios cambiados por '_'. */
+static Clave *clave_armar(Arena *a, const char *s, size_t n, uint32_t h){
+    const char *z = (const char*)memchr(s, '\0', n);
+    size_t t = z ? (size_t)(z - s) : n;
+    Clave *c = (Clave*)arena_alloc(a, sizeof *c + n + 2*t + 5);
+    char *key = (char*)(c + 1), *d = key + n;
+    memcpy(key, s, n);
+    c->key = key; c->klen = n; c->hash = h; c->id = 0;
+    c->tags = d; c->olen = t + 2; c->clen = t + 3;
+    *d++ = '<';
+    for (size_t i = 0; i < t; i++) *d++ = s[i]==' ' ? '_' : s[i];
+    *d++ = '>'; *d++ = '<'; *d++ = '/';
+    memcpy(d, c->tags + 1, t); d += t;
+    *d = '>';
+    return c;
+}
+
+static void claves_init(TablaClaves *t){
+    t->cap = 256; t->n = 0; t->lookups = t->hits = 0;
+    t->slots = (Clave**)calloc(t->cap, sizeof *t->slots);
+    if (!t->slots){ fprintf(stderr,"Out of memory\n"); exit(1); }
+    arena_init(&t->mem);
+}
+static void claves_free(TablaClaves *t){
+    free(t->slots);
+    arena_free(&t->mem);
+}
+static void claves_crecer(TablaClaves *t){
+    size_t cap = t->cap * 2;
+    Clave **nue = (Clave**)calloc(cap, sizeof *nue);
+    if (!nue){ fprintf(stderr,"Out of memory\n"); exit(1); }
+    for (size_t i = 0; i < t->cap; i++){
+        Clave *c = t->slots[i];
+        if (!c) continue;
+        size_t j = c->hash & (cap - 1);
+        while (nue[j]) j = (j + 1) & (cap - 1);
+        nue[j] = c;
     }
+    free(t->slots);
+    t->slots = nue; t->cap = cap;
 }
-static char* dup_tag_from_string_lex(const char *str){
-    char *tag = (char*)xmalloc(strlen(str)+1);
-    strcpy(tag, str);
-    for (char *p=tag; *p; ++p) if (*p==' ') *p='_';
-    return tag;
+
+/* Clave para el lexema s[0..n) de un STRING usado como nombre de atributo */
+static const Clave *intern_key(Parser *p, const char *s, size_t n){
+    TablaClaves *t = &p->claves;
+    uint32_t h = clave_hash(s, n);
+    size_t i = h & (t->cap - 1);
+    t->lookups++;
+    for (Clave *c; (c = t->slots[i]) != NULL; i = (i + 1) & (t->cap - 1)){
+        if (c->hash == h && c->klen == n && memcmp(c->key, s, n) == 0){ t->hits++; return c; }
+    }
+    if (t->n >= CLAVES_MAX) return clave_armar(&p->arena, s, n, h);
+    Clave *c = clave_armar(&t->mem, s, n, h);
+    c->id = (uint32_t)t->n++;
+    t->slots[i] = c;
+    if (t->n * 2 > t->cap) claves_crecer(t);
+    return c;
 }
 
 /* forward decls */
-static void element(Parser *p, const char *tag);
-static void object(Parser *p, const char *tag);
-static void array(Parser *p, const char *tag);
-static void attribute(Parser *p);
+static void element(Parser *p, const Clave *key);
+static void document(Parser *p);
 static int match(Parser *p, TokenType t);
+static int array_paralelo(Parser *p);
 
 /* match con error suave */
 static int match(Parser *p, TokenType t){
@@ -218,134 +1059,1584 @@ static int match(Parser *p, TokenType t){
 
 /* json -> element EOF */
 static void json(Parser *p){
-    element(p, NULL);
+    document(p);
     if (p->la.type != T_EOF)
         report(p, "Tokens despues del final del JSON", "EOF");
 }
 
-/* element -> object | array | string | number | true | false | null */
-static void element(Parser *p, const char *tag){
-    switch (p->la.type){
-        case T_LBRACE: object(p, tag); break;
-        case T_LBRACKET: array(p, tag); break;
-        case T_STRING:
-        case T_NUMBER:
-        case T_TRUE:
-        case T_FALSE:
-        case T_NULL: {
-            const char *used = tag ? tag : "value";
-            fprintf(p->out, "<%s>", used);
-            const char *txt =
-                (p->la.type==T_STRING || p->la.type==T_NUMBER)
-                ? p->la.lex
-                : (p->la.type==T_TRUE ? "true" : (p->la.type==T_FALSE ? "false" : "null"));
-            xml_text(p->out, txt ? txt : "");
-            fprintf(p->out, "</%s>", used);
+/* stream -> element* EOF : documentos concatenados o NDJSON. Cada registro
+ * sale en su propia linea y al terminarlo la arena vuelve a cero. */
+static void json_stream(Parser *p){
+    ArenaMark m = arena_mark(&p->arena);
+    while (p->la.type != T_EOF){
+        TokenType t = p->la.type;
+        if (t==T_COMMA || t==T_COLON || t==T_RBRACE || t==T_RBRACKET){
+            /* token suelto entre registros: no empieza ningun documento */
+            report(p, "Se esperaba un elemento", "objeto/array/valor");
             advance(p);
-            break;
+            continue;
         }
-        default:
-            report(p, "Se esperaba un elemento", "objeto/array/valor");
-            sync_until(p, stop_elem);
-            break;
+        if (p->records) ob_put(p->out, "\n", 1);
+        document(p);
+        p->records++;
+        arena_reset_to(p, m);
     }
+    if (p->records) ob_put(p->out, "\n", 1);
 }
 
-/* object -> { attributes-list } | {} */
-static void object(Parser *p, const char *tag){
-    int opened = 0;
-    if (!match(p, T_LBRACE)) return;
-    if (tag){ fprintf(p->out, "<%s>", tag); opened=1; }
-    if (p->la.type == T_RBRACE){ advance(p); if (opened) fprintf(p->out, "</%s>", tag); return; }
-    attribute(p);
-    while (p->la.type == T_COMMA){ advance(p); attribute(p); }
-    if (!match(p, T_RBRACE)){
-        sync_until(p, stop_attr);
-        if (p->la.type==T_RBRACE) advance(p);
+static void push_frame(Parser *p, FrameKind k, const Clave *key, uint64_t sel){
+    if (p->depth == p->cap){
+        p->cap = p->cap ? p->cap*2 : 64;
+        p->stack = (Frame*)xrealloc(p->stack, p->cap * sizeof *p->stack);
+    }
+    Frame *f = &p->stack[p->depth++];
+    EST(est_profundidad(p->depth));
+    f->kind = k; f->key = key;
+    f->mark = arena_mark(&p->arena);
+    f->sel = sel; f->index = 0; f->item = 0;
+}
+
+/* salta un valor completo (corchetes balanceados) sin traducirlo */
+static void skip_value(Parser *p){
+    size_t d = 0;
+    do {
+        TokenType t = p->la.type;
+        if (t == T_EOF) return;
+        if (t==T_LBRACE || t==T_LBRACKET) d++;
+        else if ((t==T_RBRACE || t==T_RBRACKET) && d) d--;
+        advance(p);
+    } while (d);
+}
+
+/*--- --select ---*/
+/* Agrega el patron pat ("" es todo el documento). 0 si no empieza con '/'
+ * o ya hay SEL_MAX patrones. */
+static int filtro_agregar(Filtro *f, const char *pat){
+    if (f->n == SEL_MAX || (pat[0] && pat[0] != '/')) return 0;
+    size_t n = 0;
+    for (const char *c = pat; *c; c++) n += *c == '/';
+    Segmento *g = (Segmento*)xmalloc((n ? n : 1) * sizeof *g);
+    const char *c = pat;
+    for (size_t i = 0; i < n; i++){
+        const char *ini = ++c;
+        while (*c && *c != '/') c++;
+        char *d = (char*)xmalloc((size_t)(c - ini) + 1);
+        size_t m = 0;
+        for (const char *x = ini; x < c; x++){
+            if (*x == '~' && x + 1 < c && (x[1] == '0' || x[1] == '1')){ d[m++] = x[1] == '0' ? '~' : '/'; x++; }
+            else d[m++] = *x;
+        }
+        d[m] = '\0';
+        g[i].s = d; g[i].n = m;
+        g[i].any = m == 1 && d[0] == '*';
+        g[i].idx = -1;                       /* indice: 0 o [1-9][0-9]* */
+        if (m && m <= 18 && (d[0] != '0' || m == 1)){
+            long long v = 0;
+            size_t t = 0;
+            for (; t < m && d[t] >= '0' && d[t] <= '9'; t++) v = v * 10 + (d[t] - '0');
+            if (t == m) g[i].idx = v;
+        }
+    }
+    f->seg[f->n] = g; f->nseg[f->n] = n;
+    if (!n) f->raiz = SEL_TODO;
+    else if (f->raiz != SEL_TODO) f->raiz |= 1ULL << f->n;
+    f->n++;
+    return 1;
+}
+static void filtro_free(Filtro *f){
+    for (size_t j = 0; j < f->n; j++){
+        for (size_t i = 0; i < f->nseg[j]; i++) free(f->seg[j][i].s);
+        free(f->seg[j]);
     }
-    if (opened) fprintf(p->out, "</%s>", tag);
+    f->n = 0;
 }
 
-/* attribute -> "name" : value */
-static void attribute(Parser *p){
+/* Seleccion del hijo de un contenedor con seleccion sel y profundidad d:
+ * el miembro de clave k[0..kn) o, con k NULL, el elemento idx del array. */
+static uint64_t sel_child(const Filtro *f, uint64_t sel, size_t d,
+                          const char *k, size_t kn, size_t idx){
+    if (sel & SEL_TODO) return SEL_TODO;
+    uint64_t r = 0;
+    for (uint64_t b = sel; b; b &= b - 1){
+        int j = idx_ctz(b);
+        const Segmento *g = &f->seg[j][d];
+        int ok = g->any || (k ? g->n == kn && memcmp(g->s, k, kn) == 0
+                              : g->idx == (long long)idx);
+        if (!ok) continue;
+        if (d + 1 == f->nseg[j]) return SEL_TODO;
+        r |= 1ULL << j;
+    }
+    return r;
+}
+
+/* Salta el valor que sigue al separador en la (':', ',' o '[') sin armar
+ * tokens; la queda en lo que viene despues. */
+static void skip_next_raw(Parser *p){
+    token_free(&p->la);
+    sc_skip_value(&p->sc, 0);
+    p->la = next_token(&p->sc);
+}
+
+/* Cierra el <item> abierto del array f (el de arriba) y busca el proximo
+ * elemento seleccionado, salteando los demas. la esta en el '[' recien
+ * abierto o despues de un elemento. Devuelve 1 con la en el primer token
+ * del elemento (y su <item> escrito) o 0 si el array no tiene mas. */
+static int array_next(Parser *p, Frame *f, uint64_t *sel){
+    if (f->item){
+        ob_put(p->out, "</item>", 7);
+        f->item = 0;
+        arena_reset_to(p, f->mark);
+        if (p->la.type != T_COMMA) return 0;
+        f->index++;
+    }
+    for (;;){
+        uint64_t s = sel_child(p->filtro, f->sel, p->depth - 1, NULL, 0, f->index);
+        TokenType sep = p->la.type;
+        if (s){
+            advance(p);
+            if (sep == T_LBRACKET && p->la.type == T_RBRACKET) return 0;   /* [] */
+            ob_put(p->out, "<item>", 6);
+            f->item = 1;
+            *sel = s;
+            return 1;
+        }
+        skip_next_raw(p);
+        if (p->la.type != T_COMMA) return 0;
+        f->index++;
+    }
+}
+
+/* attribute -> "name" : value
+ * Devuelve 1 (y la clave y su seleccion) si hay que traducir el valor, 0
+ * si el atributo ya termino con error o, con --select, se salteo. */
+static int attribute_start(Parser *p, const Clave **key, uint64_t *sel){
     if (p->la.type != T_STRING){
         report(p, "Nombre de atributo invalido", "string");
         sync_until(p, stop_attr);
-        return;
+        return 0;
     }
-    char *tag = dup_tag_from_string_lex(p->la.lex ? p->la.lex : "attr");
+    const Frame *f = &p->stack[p->depth-1];
+    *sel = SEL_TODO;
+    if (f->sel != SEL_TODO){
+        *sel = sel_child(p->filtro, f->sel, p->depth - 1, p->la.lex, p->la.len, 0);
+        if (!*sel){                     /* no seleccionado: ni se interna la clave */
+            advance(p);
+            if (p->la.type != T_COLON){
+                match(p, T_COLON);
+                sync_until(p, stop_attr);
+                return 0;
+            }
+            skip_next_raw(p);
+            return 0;
+        }
+    }
+    const Clave *k = p->la.lex ? intern_key(p, p->la.lex, p->la.len)
+                               : intern_key(p, "attr", 4);
     advance(p);
-    if (!match(p, T_COLON)){ sync_until(p, stop_attr); free(tag); return; }
-    element(p, tag);
-    free(tag);
-}
-
-/* array -> [element-list] | [] */
-static void array(Parser *p, const char *tag){
-    int opened = 0;
-    if (!match(p, T_LBRACKET)) return;
-    if (tag){ fprintf(p->out, "<%s>", tag); opened=1; }
-    if (p->la.type == T_RBRACKET){ advance(p); if (opened) fprintf(p->out, "</%s>", tag); return; }
-    fprintf(p->out, "<item>");
-    element(p, NULL);
-    fprintf(p->out, "</item>");
-    while (p->la.type == T_COMMA){
-        advance(p);
-        fprintf(p->out, "<item>");
-        element(p, NULL);
-        fprintf(p->out, "</item>");
+    if (!match(p, T_COLON)){ sync_until(p, stop_attr); return 0; }
+    *key = k;
+    return 1;
+}
+
+/* element   -> object | array | string | number | true | false | null
+ * object    -> { attributes-list } | {}
+ * array     -> [element-list] | []
+ *
+ * Sin recursion: cada objeto/array abierto es un marco en p->stack, asi la
+ * profundidad no consume pila de C y se limita con max_depth. El ciclo
+ * alterna entre empezar un elemento y, cuando este termina, continuar el
+ * marco de arriba (siguiente atributo/elemento o cierre). */
+static void element(Parser *p, const Clave *key){
+    uint64_t sel = p->filtro ? p->filtro->raiz : SEL_TODO;
+    for (;;){
+        /*--- empezar un elemento con la etiqueta de key ---*/
+        int child = 0;   /* 1 si se abrio un marco y sigue un elemento hijo */
+        switch (p->la.type){
+            case T_LBRACE:
+            case T_LBRACKET: {
+                FrameKind k = p->la.type==T_LBRACE ? F_OBJECT : F_ARRAY;
+                TokenType close = k==F_OBJECT ? T_RBRACE : T_RBRACKET;
+                if (p->depth >= p->max_depth){
+                    report(p, "Profundidad maxima excedida", NULL);
+                    skip_value(p);
+                    break;
+                }
+                if (k == F_ARRAY && sel != SEL_TODO){
+                    /* --select: los elementos se eligen por indice en array_next */
+                    if (key) ob_put(p->out, key->tags, key->olen);
+                    push_frame(p, k, key, sel);
+                    break;
+                }
+                advance(p);
+                if (key) ob_put(p->out, key->tags, key->olen);
+                if (p->la.type == close){
+                    advance(p);
+                    if (key) ob_put(p->out, key->tags + key->olen, key->clen);
+                    break;
+                }
+                push_frame(p, k, key, sel);
+                if (k == F_ARRAY){
+                    /* --parallel: todos los elementos de una vez; queda el ']' */
+                    if (p->paralelo && array_paralelo(p)) break;
+                    ob_put(p->out, "<item>", 6);
+                    key = NULL; child = 1;
+                } else {
+                    child = attribute_start(p, &key, &sel);
+                }
+                break;
+            }
+            case T_STRING:
+            case T_NUMBER:
+            case T_TRUE:
+            case T_FALSE:
+            case T_NULL: {
+                if (sel != SEL_TODO){ advance(p); break; }   /* --select pedia algo mas adentro */
+                const Clave *used = key ? key : &clave_value;
+                ob_put(p->out, used->tags, used->olen);
+                if (p->la.type==T_NUMBER && p->canonical){
+                    char c[NUM_CANON_MAX];
+                    size_t n = num_canonico(&p->la.num, c);
+                    if (n) ob_put(p->out, c, n);   /* sin '&', '<' ni '>' */
+                    else xml_text(p->out, p->la.lex, p->la.len);
+                } else if (p->la.type==T_STRING || p->la.type==T_NUMBER)
+                    xml_text(p->out, p->la.lex ? p->la.lex : "", p->la.len);
+                else {
+                    const char *txt = p->la.type==T_TRUE ? "true" : (p->la.type==T_FALSE ? "false" : "null");
+                    xml_text(p->out, txt, strlen(txt));
+                }
+                ob_put(p->out, used->tags + used->olen, used->clen);
+                advance(p);
+                break;
+            }
+            default:
+                report(p, "Se esperaba un elemento", "objeto/array/valor");
+                sync_until(p, stop_elem);
+                break;
+        }
+        if (child) continue;
+
+        /*--- el elemento termino: continuar los marcos abiertos ---*/
+        for (;;){
+            if (p->depth == 0) return;
+            Frame *f = &p->stack[p->depth-1];
+            if (f->kind == F_ARRAY){
+                if (f->sel != SEL_TODO){
+                    if (array_next(p, f, &sel)){ key = NULL; break; }
+                } else {
+                    ob_put(p->out, "</item>", 7);
+                    arena_reset_to(p, f->mark);
+                    if (p->la.type == T_COMMA){
+                        advance(p);
+                        ob_put(p->out, "<item>", 6);
+                        key = NULL; sel = SEL_TODO;
+                        break;                  /* siguiente elemento */
+                    }
+                }
+                if (!match(p, T_RBRACKET)){
+                    sync_until(p, stop_elem);
+                    if (p->la.type==T_RBRACKET) advance(p);
+                }
+            } else {
+                arena_reset_to(p, f->mark);
+                if (p->la.type == T_COMMA){
+                    advance(p);
+                    if (attribute_start(p, &key, &sel)) break;   /* valor del atributo */
+                    continue;                   /* atributo con error: sigue el objeto */
+                }
+                if (!match(p, T_RBRACE)){
+                    sync_until(p, stop_attr);
+                    if (p->la.type==T_RBRACE) advance(p);
+                }
+            }
+            if (f->key) ob_put(p->out, f->key->tags + f->key->olen, f->key->clen);
+            p->depth--;
+        }
+    }
+}
+
+/*======================
+  Arrays en paralelo (--parallel)
+======================*/
+/* Un array grande de una entrada mapeada se traduce en varios hilos. Una
+ * pasada por el indice estructural (comun/indice.h) cuenta llaves y
+ * corchetes hasta el ']' que lo cierra y corta los elementos en tandas en
+ * las ',' de su nivel. Cada obrero traduce tandas enteras con su propio
+ * Parser, sobre el tramo de la tanda, a un OutBuf en memoria; el hilo del
+ * parser las escribe en orden, asi la salida es la misma que sin hilos.
+ * Si una tanda tiene errores, desde ella se sigue sin hilos: los mensajes
+ * salen de la traduccion de siempre, con la linea y la columna contadas
+ * desde el principio de la entrada. */
+#define PAR_MINIMO (1u << 20)        /* arrays de al menos 1 MB */
+#define PAR_TANDA_MIN (1u << 16)
+#define PAR_TANDAS 4                 /* tandas por hilo, para repartir parejo */
+
+typedef struct {
+    size_t ini, fin;   /* elementos en [ini, fin) de la entrada; en fin su ',' o el ']' */
+    char *xml; size_t n;
+    int errores;
+    int listo;         /* el obrero termino (xml y errores valen) */
+} Tanda;
+
+typedef struct {
+    const Parser *p;   /* el parser principal: opciones y profundidad */
+    Tanda *t;
+    size_t n;
+    size_t siguiente;  /* proxima tanda sin tomar */
+    int parar;         /* hubo una tanda con errores: no tomar mas */
+} Reparto;
+
+/* Los elementos de la tanda t, cada uno en su <item>. El </item> del
+ * ultimo elemento del array lo escribe el marco, como sin hilos. */
+static void tanda_traducir(const Parser *p, Tanda *t, int ultima){
+    Parser w;
+    OutBuf ob;
+    ob_init(&ob, -1);
+    arena_init(&w.arena);
+    claves_init(&w.claves);
+    sc_rango(&w.sc, p->sc.buf + t->ini, t->fin - t->ini);
+    w.sc.arena = &w.arena;
+    w.sc.numbers = p->sc.numbers;
+    w.la = next_token(&w.sc);
+    w.out = &ob;
+    w.errors = 0;
+    w.records = 0;
+    w.stack = NULL; w.depth = w.cap = 0;
+    w.max_depth = p->max_depth - p->depth;   /* el array ya es un marco */
+    w.canonical = p->canonical;
+    w.tape = NULL; w.filtro = NULL; w.pointer = ""; w.columnar = 0;
+    w.paralelo = 0; w.mudo = 1;
+    w.nombre = NULL;
+    w.diag = NULL;
+    ArenaMark m = arena_mark(&w.arena);
+    for (;;){
+        ob_put(&ob, "<item>", 6);
+        element(&w, NULL);
+        arena_reset_to(&w, m);
+        if (w.errors) break;
+        if (w.la.type != T_COMMA){
+            if (w.la.type != T_EOF) w.errors++;   /* algo despues del elemento */
+            break;
+        }
+        ob_put(&ob, "</item>", 7);
+        advance(&w);
+    }
+    if (!ultima) ob_put(&ob, "</item>", 7);
+    token_free(&w.la);
+    free(w.stack);
+    sc_close(&w.sc);
+    ob_free(&ob);
+    arena_free(&w.arena);
+    claves_free(&w.claves);
+    t->xml = ob.mem; t->n = ob.mem_len;
+    t->errores = w.errors;
+}
+
+static void obrero_tandas(void *x){
+    Reparto *r = (Reparto*)x;
+    while (!__atomic_load_n(&r->parar, __ATOMIC_RELAXED)){
+        size_t i = __atomic_fetch_add(&r->siguiente, 1, __ATOMIC_RELAXED);
+        if (i >= r->n) return;
+        Tanda *t = &r->t[i];
+        tanda_traducir(r->p, t, i + 1 == r->n);
+        if (t->errores) __atomic_store_n(&r->parar, 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&t->listo, 1, __ATOMIC_RELEASE);
+    }
+}
+
+/* Lleva el scanner hasta q (mas adelante, fuera de cadena) y lee el token
+ * de ahi. */
+static void saltar_a(Parser *p, size_t q){
+    token_free(&p->la);
+    sc_jump(&p->sc, q);
+    p->sc.mark = q;
+    p->sc.ix_n = p->sc.ix_i = 0; p->sc.ix_end = 0;   /* el indice sigue desde q */
+    p->la = next_token(&p->sc);
+}
+
+/* Cortes del array cuyo primer elemento empieza en ini: tandas de al
+ * menos tam bytes. 0 si no se encontro el ']' que lo cierra. */
+static size_t array_tandas(const Scanner *sc, size_t ini, size_t tam, Tanda **out){
+    Tanda *t = NULL;
+    size_t nt = 0, cap = 0, prof = 0, desde = ini, a = ini;
+    int fin = 0;
+    IdxEstado st;
+    idx_iniciar(&st);
+    uint32_t *pos = (uint32_t*)xmalloc(IX_TRAMO * sizeof *pos);
+    while (!fin && a < sc->len){
+        size_t n = sc->len - a < IX_TRAMO ? sc->len - a : IX_TRAMO;
+        size_t k = idx_tramo(&st, sc->buf + a, n, pos);
+        for (size_t j = 0; j < k && !fin; j++){
+            size_t q = a + pos[j];
+            char c = sc->buf[q];
+            if (c == '{' || c == '['){ prof++; continue; }
+            if (c == '}' || c == ']'){
+                if (prof){ prof--; continue; }
+                if (c == '}'){ nt = 0; fin = 2; break; }   /* no cierra el array */
+            } else if (c != ',' || prof || q - desde < tam) continue;
+            if (nt == cap){
+                cap = cap ? cap * 2 : 64;
+                t = (Tanda*)xrealloc(t, cap * sizeof *t);
+            }
+            t[nt].ini = desde; t[nt].fin = q;
+            t[nt].xml = NULL; t[nt].n = 0; t[nt].errores = 0; t[nt].listo = 0;
+            nt++;
+            desde = q + 1;
+            if (c == ']') fin = 1;
+        }
+        a += n;
+    }
+    free(pos);
+    if (fin != 1) nt = 0;
+    if (!nt){ free(t); t = NULL; }
+    *out = t;
+    return nt;
+}
+
+/* la es el primer elemento del array recien abierto. Devuelve 1 si se
+ * tradujeron todos (la queda en el ']'); 0 si se sigue sin hilos desde
+ * la, que puede haber avanzado hasta la primera tanda con errores. */
+static int array_paralelo(Parser *p){
+    Scanner *sc = &p->sc;
+    size_t ini = sc->mark;           /* inicio del lookahead */
+    if (!sc->map || p->la.type == T_EOF || sc->len - ini < PAR_MINIMO) return 0;
+    size_t tam = (sc->len - ini) / (p->paralelo * PAR_TANDAS);
+    if (tam < PAR_TANDA_MIN) tam = PAR_TANDA_MIN;
+    Tanda *t;
+    size_t nt = array_tandas(sc, ini, tam, &t);
+    if (!nt){
+        p->paralelo = 0;             /* mal formado: no volver a recorrerlo */
+        return 0;
+    }
+    if (nt < 2 || t[nt-1].fin - ini < PAR_MINIMO){ free(t); return 0; }
+
+    Reparto r;
+    r.p = p; r.t = t; r.n = nt; r.siguiente = 0; r.parar = 0;
+    size_t hilos = p->paralelo < nt ? p->paralelo : nt, creados = 0;
+    Hilo **h = (Hilo**)xmalloc(hilos * sizeof *h);
+    for (size_t k = 0; k < hilos; k++) creados += (h[k] = hilo_crear(obrero_tandas, &r)) != NULL;
+    if (!creados) obrero_tandas(&r);     /* sin hilos: todas en este */
+    size_t i;
+    for (i = 0; i < nt; i++){
+        unsigned intentos = 0;
+        while (!__atomic_load_n(&t[i].listo, __ATOMIC_ACQUIRE)) hilo_pausa(&intentos);
+        if (t[i].errores) break;
+        ob_put(p->out, t[i].xml, t[i].n);
+        free(t[i].xml); t[i].xml = NULL;
     }
-    if (!match(p, T_RBRACKET)){
-        sync_until(p, stop_elem);
-        if (p->la.type==T_RBRACKET) advance(p);
+    __atomic_store_n(&r.parar, 1, __ATOMIC_RELAXED);
+    for (size_t k = 0; k < hilos; k++) if (h[k]) hilo_esperar(h[k]);
+    free(h);
+    size_t hasta = i == nt ? t[nt-1].fin : t[i].ini;
+    for (size_t j = i; j < nt; j++) free(t[j].xml);
+    free(t);
+    if (i) saltar_a(p, hasta);
+    return i == nt;
+}
+
+/*======================
+  Cinta (--tape, --pointer)
+======================*/
+/* "name" : de un miembro de objeto, guardado en la cinta */
+static int tape_key(Parser *p, Cinta *c){
+    if (p->la.type != T_STRING){
+        report(p, "Nombre de atributo invalido", "string");
+        return 0;
+    }
+    cinta_cadena(c, p->la.lex, p->la.len);
+    advance(p);
+    return match(p, T_COLON);
+}
+
+/* element -> ... como element(), pero solo guarda el documento en la cinta
+ * (comun/cinta.h). Sin recuperacion: al primer error se descarta el resto
+ * del documento hasta cerrar lo abierto y devuelve 0. */
+static int tape_build(Parser *p, Cinta *c){
+    ArenaMark m = arena_mark(&p->arena);
+    cinta_vaciar(c);
+    for (;;){
+        /*--- un valor ---*/
+        switch (p->la.type){
+            case T_LBRACE:
+            case T_LBRACKET: {
+                char k = p->la.type==T_LBRACE ? '{' : '[';
+                if (c->prof >= p->max_depth){
+                    report(p, "Profundidad maxima excedida", NULL);
+                    goto error;
+                }
+                cinta_abrir(c, k);
+                EST(est_profundidad(c->prof));
+                advance(p);
+                if (p->la.type == (k=='{' ? T_RBRACE : T_RBRACKET)){
+                    cinta_cerrar(c);
+                    advance(p);
+                    break;
+                }
+                if (k=='{' && !tape_key(p, c)) goto error;
+                continue;
+            }
+            case T_STRING: cinta_cadena(c, p->la.lex, p->la.len); advance(p); break;
+            case T_NUMBER: cinta_numero(c, p->la.lex, p->la.len, &p->la.num); advance(p); break;
+            case T_TRUE:   cinta_literal(c, 't'); advance(p); break;
+            case T_FALSE:  cinta_literal(c, 'f'); advance(p); break;
+            case T_NULL:   cinta_literal(c, 'n'); advance(p); break;
+            default:
+                report(p, "Se esperaba un elemento", "objeto/array/valor");
+                goto error;
+        }
+        arena_reset_to(p, m);   /* la cinta ya copio el lexema */
+
+        /*--- el valor termino: continuar los contenedores abiertos ---*/
+        for (;;){
+            char k = cinta_abierto(c);
+            if (!k) return 1;
+            if (p->la.type == T_COMMA){
+                advance(p);
+                if (k=='{' && !tape_key(p, c)) goto error;
+                break;
+            }
+            if (!match(p, k=='{' ? T_RBRACE : T_RBRACKET)) goto error;
+            cinta_cerrar(c);
+        }
+    }
+error:
+    if (!c->prof) sync_until(p, stop_elem);   /* como element() */
+    for (size_t d = c->prof; d && p->la.type != T_EOF; advance(p)){
+        TokenType t = p->la.type;
+        if (t==T_LBRACE || t==T_LBRACKET) d++;
+        else if (t==T_RBRACE || t==T_RBRACKET) d--;
+    }
+    arena_reset_to(p, m);
+    return 0;
+}
+
+/* Traduce el valor que empieza en la entrada i con la misma salida que
+ * element(); la pila de marcos guarda las etiquetas a cerrar. */
+static void tape_element(Parser *p, const Cinta *c, size_t i, const Clave *key){
+    size_t base = p->depth;
+    for (;;){
+        /*--- empezar un elemento con la etiqueta de key ---*/
+        char t = cinta_tipo(c, i);
+        size_t n;
+        const char *s;
+        if (t == '{' || t == '['){
+            if (key) ob_put(p->out, key->tags, key->olen);
+            if (cinta_dato(c, i) == i + 1){
+                if (key) ob_put(p->out, key->tags + key->olen, key->clen);
+                i += 2;
+            } else {
+                push_frame(p, t=='{' ? F_OBJECT : F_ARRAY, key, SEL_TODO);
+                i++;
+                if (t == '['){
+                    ob_put(p->out, "<item>", 6);
+                    key = NULL;
+                } else {
+                    s = cinta_texto(c, i++, &n);
+                    key = intern_key(p, s, n);
+                }
+                continue;
+            }
+        } else {
+            const Clave *used = key ? key : &clave_value;
+            ob_put(p->out, used->tags, used->olen);
+            if (t == '"') { s = cinta_texto(c, i, &n); xml_text(p->out, s, n); }
+            else if (t == 'l' || t == 'd'){
+                Numero v;
+                char canon[NUM_CANON_MAX];
+                size_t k = 0;
+                if (p->canonical){
+                    v.tipo = t == 'l' ? NUM_ENTERO : NUM_REAL;
+                    memcpy(t == 'l' ? (void*)&v.entero : (void*)&v.real, &c->t[i+1], sizeof c->t[i+1]);
+                    v.dec = 0;
+                    k = num_canonico(&v, canon);
+                }
+                if (k) ob_put(p->out, canon, k);
+                else { s = cinta_texto(c, i, &n); xml_text(p->out, s, n); }
+            }
+            else if (t == 't') ob_put(p->out, "true", 4);
+            else if (t == 'f') ob_put(p->out, "false", 5);
+            else ob_put(p->out, "null", 4);
+            ob_put(p->out, used->tags + used->olen, used->clen);
+            i = cinta_siguiente(c, i);
+        }
+
+        /*--- el elemento termino: continuar los marcos abiertos ---*/
+        for (;;){
+            if (p->depth == base) return;
+            Frame *f = &p->stack[p->depth-1];
+            t = cinta_tipo(c, i);
+            if (f->kind == F_ARRAY){
+                ob_put(p->out, "</item>", 7);
+                arena_reset_to(p, f->mark);
+                if (t != ']'){
+                    ob_put(p->out, "<item>", 6);
+                    key = NULL;
+                    break;                      /* siguiente elemento */
+                }
+            } else {
+                arena_reset_to(p, f->mark);
+                if (t != '}'){
+                    s = cinta_texto(c, i++, &n);
+                    key = intern_key(p, s, n);
+                    break;                      /* siguiente atributo */
+                }
+            }
+            i++;
+            if (f->key) ob_put(p->out, f->key->tags + f->key->olen, f->key->clen);
+            p->depth--;
+        }
     }
-    if (opened) fprintf(p->out, "</%s>", tag);
+}
+
+/* --columnar: la salida de col_traducir va al OutBuf y sus mensajes a stderr */
+static void col_poner(void *ctx, const void *s, size_t n){
+    ob_put(((Parser*)ctx)->out, (const char*)s, n);
+}
+static void col_error(void *ctx, const char *msg){
+    Parser *p = (Parser*)ctx;
+    char linea[512];
+    snprintf(linea, sizeof linea, "%s%s[Columnas] %s", p->nombre ? p->nombre : "", p->nombre ? ": " : "", msg);
+    mensaje(p, linea);
+    p->errors++;
+}
+
+/* Un documento: directo desde los tokens o, con cinta, armandola primero y
+ * traduciendo el documento entero, solo el valor de --pointer o, con
+ * --columnar, sus tablas (comun/columnas.h). */
+static void document(Parser *p){
+    if (!p->tape){ element(p, NULL); return; }
+    if (!tape_build(p, p->tape)) return;
+    if (p->columnar){
+        col_traducir(p->tape, p->columnar, col_poner, col_error, p);
+        return;
+    }
+    size_t k, i = cinta_puntero(p->tape, p->pointer, strlen(p->pointer), &k);
+    if (i == CINTA_NADA){
+        char linea[512];
+        snprintf(linea, sizeof linea, "%s%s[Puntero] '%s' no existe en el documento",
+                 p->nombre ? p->nombre : "", p->nombre ? ": " : "", p->pointer);
+        mensaje(p, linea);
+        p->errors++;
+        return;
+    }
+    const Clave *key = NULL;
+    if (k != CINTA_NADA){
+        size_t n;
+        const char *s = cinta_texto(p->tape, k, &n);
+        key = intern_key(p, s, n);
+    }
+    tape_element(p, p->tape, i, key);
 }
 
 /*======================
   Main
 ======================*/
+/* antes de bloquearse leyendo la entrada se vuelca lo ya traducido */
+static void flush_on_read(void *ctx){ ob_flush((OutBuf*)ctx); }
+
+typedef struct {
+    int stream, canonical, tape, arena_stats, pipeline;
+    size_t columnar;        /* filas de muestra con --columnar (0: XML) */
+    size_t paralelo;        /* hilos con --parallel (0: sin hilos) */
+    const char *pointer;
+    const Filtro *filtro;   /* NULL: todo el documento */
+    size_t max_depth;
+} Opciones;
+
+typedef struct {
+    int errors;       /* errores de sintaxis */
+    size_t records;   /* documentos con --stream */
+    int werr;         /* errno al escribir la salida (0: bien) */
+} Traduccion;
+
+/* Traduce in a out. nombre (o NULL) va al frente de los mensajes de
+ * error. Con --stats escribe la global est (los EST del escaner y del
+ * parser, y est_reportar al final). --batch la corre en varios hilos y
+ * --parallel y --serve usan el mismo escaner y parser desde los suyos:
+ * es seguro solo porque main rechaza --stats con los tres. */
+static Traduccion traducir(const Opciones *op, FILE *in, FILE *out, const char *nombre){
+    Parser P;
+    OutBuf ob;
+    Cinta cinta;
+    Traduccion r;
+    ob_init(&ob, fileno(out));
+    arena_init(&P.arena);
+    claves_init(&P.claves);
+    sc_init(&P.sc, in, op->stream || op->pipeline);
+    P.sc.arena = &P.arena;
+    P.sc.numbers = op->canonical || op->tape;   /* la cinta guarda el valor */
+    if (op->pipeline){
+        P.sc.tub = etapa_nueva(P.sc.fd, TUB_BLOQUE, lector);
+        ob_tuberia(&ob);
+    }
+    if (op->stream){ P.sc.on_read = flush_on_read; P.sc.on_read_ctx = &ob; }
+    sc_start(&P.sc);
+    P.la = next_token(&P.sc);
+    P.out = &ob;
+    P.errors = 0;
+    P.records = 0;
+    P.stack = NULL; P.depth = P.cap = 0;
+    P.max_depth = op->max_depth;
+    P.canonical = op->canonical;
+    cinta_init(&cinta);
+    P.tape = op->tape ? &cinta : NULL;
+    P.pointer = op->pointer ? op->pointer : "";
+    P.columnar = op->columnar;
+    P.paralelo = op->paralelo;
+    P.mudo = 0;
+    P.filtro = op->filtro;
+    P.nombre = nombre;
+    P.diag = NULL;
+
+    if (op->stream) json_stream(&P);
+    else json(&P);
+
+    token_free(&P.la);
+    free(P.stack);
+    sc_close(&P.sc);
+    ob_free(&ob);
+    EST(est_reportar(stderr));
+    if (op->arena_stats){
+        size_t inuse = arena_in_use(&P.arena);
+        if (inuse > P.arena.peak) P.arena.peak = inuse;
+        fprintf(stderr, "Arena: %zu asignaciones y %zu crecimientos sin malloc/realloc, "
+                        "%zu bloques reservados, pico %zu bytes\n",
+                P.arena.allocs, P.arena.grows, P.arena.chunks, P.arena.peak);
+        fprintf(stderr, "Claves: %zu internadas, %zu de %zu busquedas resueltas en la tabla\n",
+                P.claves.n, P.claves.hits, P.claves.lookups);
+        if (op->tape)
+            fprintf(stderr, "Cinta: %zu entradas y %zu bytes de cadenas reservados\n",
+                    cinta.cap, cinta.cad_cap);
+    }
+    cinta_free(&cinta);
+    arena_free(&P.arena);
+    claves_free(&P.claves);
+    r.errors = P.errors; r.records = P.records; r.werr = ob.err;
+    return r;
+}
+
+/*======================
+  Lote (--batch)
+======================*/
+/* Muchos archivos en un solo proceso, repartidos entre hilos con robo de
+ * trabajo: cada hilo tiene un tramo [proximo, fin) de la lista y cuando
+ * lo vacia le roba la mitad final del tramo de otro. Tomar y robar son un
+ * CAS sobre la palabra del tramo, asi nunca dos hilos toman el mismo
+ * archivo. Cada archivo se traduce con su propio Parser (traducir) y los
+ * errores quedan en su Trabajo para el resumen del final. */
+
+enum { LOTE_OK, LOTE_SINTAXIS, LOTE_SIN_ENTRADA, LOTE_SIN_SALIDA, LOTE_ESCRITURA, LOTE_REPETIDA };
+
+typedef struct {
+    char *entrada, *salida;
+    int estado;       /* LOTE_* */
+    int errores;      /* LOTE_SINTAXIS: cuantos */
+    int err;          /* errno al abrir o escribir */
+} Trabajo;
+
+typedef struct {
+    Trabajo *t;
+    size_t n, cap;
+} ListaTrabajos;
+
+typedef struct {
+    uint64_t tramo;   /* (proximo << 32) | fin */
+    char relleno[56]; /* cada tramo en su linea de cache */
+} Cola;
+
+typedef struct {
+    const Opciones *op;
+    Trabajo *t;
+    Cola *colas;
+    size_t hilos;
+} Lote;
+
+typedef struct { Lote *lote; size_t yo; } Obrero;
+
+static char *copiar_ruta(const char *a, size_t na, const char *b, size_t nb, const char *c){
+    size_t nc = strlen(c);
+    char *s = (char*)xmalloc(na + nb + nc + 1);
+    memcpy(s, a, na); memcpy(s + na, b, nb); memcpy(s + na + nb, c, nc + 1);
+    return s;
+}
+
+static void lote_agregar(ListaTrabajos *l, const char *ruta, size_t n){
+    if (l->n == l->cap){
+        l->cap = l->cap ? l->cap * 2 : 256;
+        l->t = (Trabajo*)xrealloc(l->t, l->cap * sizeof *l->t);
+    }
+    Trabajo *t = &l->t[l->n++];
+    t->entrada = copiar_ruta(ruta, n, "", 0, "");
+    t->salida = NULL;
+    t->estado = LOTE_OK; t->errores = 0; t->err = 0;
+}
+
+static int es_barra(char c){
+#ifdef _WIN32
+    return c == '/' || c == '\\' || c == ':';
+#else
+    return c == '/';
+#endif
+}
+
+static int por_entrada(const void *a, const void *b){
+    return strcmp(((const Trabajo*)a)->entrada, ((const Trabajo*)b)->entrada);
+}
+
+/* Los .json y .txt del directorio (sin bajar a subdirectorios), en orden */
+static int lote_directorio(ListaTrabajos *l, const char *dir){
+    DIR *d = opendir(dir);
+    if (!d) return 0;
+    size_t desde = l->n, nd = strlen(dir);
+    int barra = nd && !es_barra(dir[nd - 1]);
+    struct dirent *e;
+    while ((e = readdir(d))){
+        size_t n = strlen(e->d_name);
+        if (!(n > 5 && strcmp(e->d_name + n - 5, ".json") == 0) &&
+            !(n > 4 && strcmp(e->d_name + n - 4, ".txt") == 0)) continue;
+        char *ruta = copiar_ruta(dir, nd, "/", (size_t)barra, e->d_name);
+        struct stat st;
+        if (stat(ruta, &st) == 0 && S_ISREG(st.st_mode)) lote_agregar(l, ruta, strlen(ruta));
+        free(ruta);
+    }
+    closedir(d);
+    qsort(l->t + desde, l->n - desde, sizeof *l->t, por_entrada);
+    return 1;
+}
+
+/* Una ruta por linea ('@-': la lista llega por stdin) */
+static int lote_lista(ListaTrabajos *l, const char *archivo){
+    FILE *f = strcmp(archivo, "-") == 0 ? stdin : fopen(archivo, "r");
+    if (!f) return 0;
+    char linea[4096];
+    while (fgets(linea, sizeof linea, f)){
+        size_t n = strcspn(linea, "\r\n");
+        if (n) lote_agregar(l, linea, n);
+    }
+    if (f != stdin) fclose(f);
+    return 1;
+}
+
+/* dir/base.xml, o junto a la entrada si no hay -o: datos.json -> datos.xml */
+static char *ruta_salida(const char *entrada, const char *dir){
+    const char *base = entrada + strlen(entrada);
+    while (base > entrada && !es_barra(base[-1])) base--;
+    const char *punto = strrchr(base, '.');
+    size_t nb = punto && punto != base ? (size_t)(punto - base) : strlen(base);
+    if (!dir) return copiar_ruta(entrada, (size_t)(base - entrada), base, nb, ".xml");
+    size_t nd = strlen(dir);
+    char *pre = copiar_ruta(dir, nd, "/", nd && !es_barra(dir[nd - 1]), "");
+    char *s = copiar_ruta(pre, strlen(pre), base, nb, ".xml");
+    free(pre);
+    return s;
+}
+
+static int por_salida(const void *a, const void *b){
+    const Trabajo *x = *(Trabajo *const *)a, *y = *(Trabajo *const *)b;
+    int c = strcmp(x->salida, y->salida);
+    return c ? c : (x < y ? -1 : x > y);
+}
+
+/* Dos entradas con la misma salida (a.json y a.txt) no se pisan: la que
+ * viene despues en la lista queda sin traducir, igual que una entrada
+ * que ya se llama como su salida. */
+static void marcar_repetidas(Trabajo *t, size_t n){
+    Trabajo **orden = (Trabajo**)xmalloc((n + 1) * sizeof *orden);
+    for (size_t i = 0; i < n; i++){
+        orden[i] = &t[i];
+        if (strcmp(t[i].entrada, t[i].salida) == 0) t[i].estado = LOTE_REPETIDA;
+    }
+    qsort(orden, n, sizeof *orden, por_salida);
+    for (size_t i = 1; i < n; i++)
+        if (strcmp(orden[i]->salida, orden[i - 1]->salida) == 0) orden[i]->estado = LOTE_REPETIDA;
+    free(orden);
+}
+
+static int tomar(Cola *c, size_t *i){
+    uint64_t r = __atomic_load_n(&c->tramo, __ATOMIC_ACQUIRE);
+    for (;;){
+        uint32_t prox = (uint32_t)(r >> 32), fin = (uint32_t)r;
+        if (prox >= fin) return 0;
+        if (__atomic_compare_exchange_n(&c->tramo, &r, r + (1ull << 32), 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+            *i = prox;
+            return 1;
+        }
+    }
+}
+
+/* Se lleva [mitad, fin) del primer tramo no vacio despues del propio */
+static int robar(Lote *l, size_t yo){
+    for (size_t k = 1; k < l->hilos; k++){
+        Cola *v = &l->colas[(yo + k) % l->hilos];
+        uint64_t r = __atomic_load_n(&v->tramo, __ATOMIC_ACQUIRE);
+        for (;;){
+            uint32_t prox = (uint32_t)(r >> 32), fin = (uint32_t)r;
+            if (prox >= fin) break;
+            uint32_t mitad = prox + (fin - prox) / 2;
+            if (__atomic_compare_exchange_n(&v->tramo, &r, ((uint64_t)prox << 32) | mitad, 1,
+                                            __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)){
+                __atomic_store_n(&l->colas[yo].tramo, ((uint64_t)mitad << 32) | fin, __ATOMIC_RELEASE);
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void lote_uno(const Opciones *op, Trabajo *t){
+    if (t->estado != LOTE_OK) return;
+    FILE *in = fopen(t->entrada, "rb");
+    if (!in){ t->estado = LOTE_SIN_ENTRADA; t->err = errno; return; }
+    FILE *out = fopen(t->salida, "wb");
+    if (!out){ t->estado = LOTE_SIN_SALIDA; t->err = errno; fclose(in); return; }
+    Traduccion r = traducir(op, in, out, t->entrada);
+    fclose(in);
+    if (fclose(out) != 0 && !r.werr) r.werr = errno;
+    t->errores = r.errors;
+    if (r.werr){ t->estado = LOTE_ESCRITURA; t->err = r.werr; }
+    else if (r.errors) t->estado = LOTE_SINTAXIS;
+}
+
+static void lote_obrero(void *x){
+    Obrero *o = (Obrero*)x;
+    Lote *l = o->lote;
+    size_t i;
+    do {
+        while (tomar(&l->colas[o->yo], &i)) lote_uno(l->op, &l->t[i]);
+    } while (robar(l, o->yo));
+}
+
+/* rutas: archivos, directorios o @lista. Salidas en dir (o junto a cada
+ * entrada). 0: todo bien, 2: alguno con errores de sintaxis, 1: alguno
+ * sin traducir. */
+static int lote(const Opciones *op, char **rutas, size_t nrutas, const char *dir, size_t hilos){
+    ListaTrabajos l = { NULL, 0, 0 };
+    for (size_t i = 0; i < nrutas; i++){
+        struct stat st;
+        int ok = 1;
+        if (rutas[i][0] == '@') ok = lote_lista(&l, rutas[i] + 1);
+        else if (stat(rutas[i], &st) == 0 && S_ISDIR(st.st_mode)) ok = lote_directorio(&l, rutas[i]);
+        else lote_agregar(&l, rutas[i], strlen(rutas[i]));
+        if (!ok){
+            fprintf(stderr, "No se puede leer '%s': %s\n", rutas[i], strerror(errno));
+            return 1;
+        }
+    }
+    if (l.n > UINT32_MAX){ fprintf(stderr, "Demasiados archivos en el lote\n"); return 1; }
+    for (size_t i = 0; i < l.n; i++) l.t[i].salida = ruta_salida(l.t[i].entrada, dir);
+    marcar_repetidas(l.t, l.n);
+
+    if (hilos > l.n) hilos = l.n ? l.n : 1;
+    Lote L;
+    L.op = op; L.t = l.t; L.hilos = hilos;
+    L.colas = (Cola*)xmalloc(hilos * sizeof *L.colas);
+    Obrero *obreros = (Obrero*)xmalloc(hilos * sizeof *obreros);
+    Hilo **h = (Hilo**)xmalloc(hilos * sizeof *h);
+    for (size_t k = 0; k < hilos; k++){
+        L.colas[k].tramo = ((uint64_t)(l.n * k / hilos) << 32) | (uint64_t)(l.n * (k + 1) / hilos);
+        obreros[k].lote = &L; obreros[k].yo = k;
+    }
+    idx_implementacion();   /* elige la variante SIMD antes de arrancar los hilos */
+    /* el hilo principal es el obrero 0 */
+    h[0] = NULL;
+    for (size_t k = 1; k < hilos; k++) h[k] = hilo_crear(lote_obrero, &obreros[k]);
+    lote_obrero(&obreros[0]);
+    for (size_t k = 1; k < hilos; k++)
+        if (h[k]) hilo_esperar(h[k]);
+        else lote_obrero(&obreros[k]);   /* no se pudo crear: su tramo lo hace este */
+
+    size_t bien = 0, sintaxis = 0, fallas = 0;
+    for (size_t i = 0; i < l.n; i++){
+        Trabajo *t = &l.t[i];
+        switch (t->estado){
+            case LOTE_OK: bien++; break;
+            case LOTE_SINTAXIS:
+                sintaxis++;
+                printf("%s: %d error(es) de sintaxis (salida parcial en %s)\n", t->entrada, t->errores, t->salida);
+                break;
+            case LOTE_SIN_ENTRADA:
+                fallas++;
+                printf("%s: no se puede abrir: %s\n", t->entrada, strerror(t->err));
+                break;
+            case LOTE_SIN_SALIDA:
+            case LOTE_ESCRITURA:
+                fallas++;
+                printf("%s: no se puede escribir '%s': %s\n", t->entrada, t->salida, strerror(t->err));
+                break;
+            case LOTE_REPETIDA:
+                fallas++;
+                printf("%s: la salida '%s' es la entrada o la de otro archivo del lote\n", t->entrada, t->salida);
+                break;
+        }
+        free(t->entrada); free(t->salida);
+    }
+    printf("Lote: %zu archivo(s) con %zu hilo(s): %zu traducido(s), %zu con errores de sintaxis, %zu sin traducir.\n",
+           l.n, hilos, bien, sintaxis, fallas);
+    free(l.t); free(L.colas); free(obreros); free(h);
+    return fallas ? 1 : sintaxis ? 2 : 0;
+}
+
+/*======================
+  Servidor (--serve)
+======================*/
+/* Un proceso residente que traduce los pedidos que llegan por un socket
+ * Unix, sin pagar en cada uno el arranque, abrir archivos ni output.xml.
+ *
+ *   pedido:    largo (uint32) y el JSON
+ *   respuesta: errores, registros (SERV_SIN_REGISTROS sin --stream), largo
+ *              del XML y largo de los mensajes (uint32 cada uno), el XML y
+ *              los mensajes, tal como report() los mostraria por stderr
+ *
+ * Los enteros van en orden de red. Por una conexion pueden ir varios
+ * pedidos seguidos y las respuestas salen en el mismo orden. Un solo hilo
+ * atiende todas las conexiones con poll(): cada pedido se traduce apenas
+ * llega entero, desde el bufer donde se recibio, y su respuesta queda en
+ * la cola de salida de la conexion. Hay un solo Parser y no se libera
+ * entre pedidos: la arena vuelve a cero y la tabla de claves, el indice
+ * del scanner, los buferes de salida y la cinta quedan reservados. Las
+ * opciones (--canonical-numbers, --select, --stream...) son las del
+ * servidor. */
+#define SERV_MAX (64u << 20)            /* pedido mas grande que se acepta */
+#define SERV_CONEXIONES 1024
+#define SERV_LECTURA (1u << 16)         /* lugar libre minimo para cada read() */
+#define SERV_PENDIENTE (1u << 20)       /* con mas respuestas sin enviar no se lee */
+#define SERV_CABECERA 16
+#define SERV_SIN_REGISTROS UINT32_MAX
+
+#ifndef _WIN32
+static void poner32(char *s, uint32_t v){
+    s[0] = (char)(v >> 24); s[1] = (char)(v >> 16); s[2] = (char)(v >> 8); s[3] = (char)v;
+}
+static uint32_t leer32(const char *s){
+    const unsigned char *u = (const unsigned char*)s;
+    return (uint32_t)u[0] << 24 | (uint32_t)u[1] << 16 | (uint32_t)u[2] << 8 | u[3];
+}
+
+typedef struct {
+    int fd;
+    char *ent; size_t ent_n, ent_cap;           /* recibido y sin traducir */
+    char *sal; size_t sal_i, sal_n, sal_cap;    /* respuestas: falta enviar [sal_i, sal_n) */
+    int cerrar;                                 /* al terminar de enviar */
+} Conexion;
+
+typedef struct {
+    const Opciones *op;
+    Parser P;
+    OutBuf ob, diag;
+    Cinta cinta;
+    ArenaMark vacia;
+    size_t pedidos, conexiones;
+} Servidor;
+
+static volatile sig_atomic_t serv_parar = 0;
+static void serv_senal(int s){ (void)s; serv_parar = 1; }
+
+static void serv_iniciar(Servidor *s, const Opciones *op){
+    Parser *P = &s->P;
+    s->op = op;
+    s->pedidos = s->conexiones = 0;
+    ob_init(&s->ob, -1);
+    ob_init(&s->diag, -1);
+    arena_init(&P->arena);
+    claves_init(&P->claves);
+    sc_rango(&P->sc, "", 0);
+    P->sc.arena = &P->arena;
+    P->sc.numbers = op->canonical || op->tape;
+    P->out = &s->ob;
+    P->diag = &s->diag;
+    P->stack = NULL; P->depth = P->cap = 0;
+    P->max_depth = op->max_depth;
+    P->canonical = op->canonical;
+    cinta_init(&s->cinta);
+    P->tape = op->tape ? &s->cinta : NULL;
+    P->pointer = op->pointer ? op->pointer : "";
+    P->columnar = op->columnar;
+    P->paralelo = 0;
+    P->mudo = 0;
+    P->filtro = op->filtro;
+    P->nombre = NULL;
+    s->vacia = arena_mark(&P->arena);
+}
+static void serv_liberar(Servidor *s){
+    free(s->P.stack);
+    sc_close(&s->P.sc);
+    ob_free(&s->ob); free(s->ob.mem);
+    ob_free(&s->diag); free(s->diag.mem);
+    cinta_free(&s->cinta);
+    arena_free(&s->P.arena);
+    claves_free(&s->P.claves);
+}
+
+/* Agrega una respuesta a la cola de salida de c */
+static void serv_responder(Conexion *c, uint32_t errores, uint32_t registros,
+                           const char *xml, size_t nx, const char *msg, size_t nm){
+    size_t n = SERV_CABECERA + nx + nm;
+    if (c->sal_i == c->sal_n) c->sal_i = c->sal_n = 0;
+    if (c->sal_n + n > c->sal_cap){
+        if (c->sal_i){                       /* lo ya enviado se descarta */
+            memmove(c->sal, c->sal + c->sal_i, c->sal_n - c->sal_i);
+            c->sal_n -= c->sal_i; c->sal_i = 0;
+        }
+        size_t cap = c->sal_cap ? c->sal_cap : SERV_LECTURA;
+        while (cap < c->sal_n + n) cap *= 2;
+        if (cap != c->sal_cap){ c->sal = (char*)xrealloc(c->sal, cap); c->sal_cap = cap; }
+    }
+    char *d = c->sal + c->sal_n;
+    poner32(d, errores); poner32(d + 4, registros);
+    poner32(d + 8, (uint32_t)nx); poner32(d + 12, (uint32_t)nm);
+    if (nx) memcpy(d + SERV_CABECERA, xml, nx);
+    if (nm) memcpy(d + SERV_CABECERA + nx, msg, nm);
+    c->sal_n += n;
+}
+
+/* Traduce el pedido texto[0..n) con el parser caliente */
+static void serv_traducir(Servidor *s, Conexion *c, const char *texto, size_t n){
+    Parser *P = &s->P;
+    sc_reusar(&P->sc, texto, n);
+    P->la = next_token(&P->sc);
+    P->errors = 0;
+    P->records = 0;
+    P->depth = 0;
+    if (s->op->stream) json_stream(P);
+    else json(P);
+    token_free(&P->la);
+    arena_release(&P->arena, s->vacia);
+    ob_flush(&s->ob);
+    ob_flush(&s->diag);
+    serv_responder(c, (uint32_t)P->errors, s->op->stream ? (uint32_t)P->records : SERV_SIN_REGISTROS,
+                   s->ob.mem, s->ob.mem_len, s->diag.mem, s->diag.mem_len);
+    s->ob.mem_len = s->diag.mem_len = 0;
+    s->pedidos++;
+}
+
+/* Traduce los pedidos completos de la entrada de c */
+static void serv_pedidos(Servidor *s, Conexion *c){
+    size_t i = 0;
+    while (!c->cerrar && c->ent_n - i >= 4){
+        uint32_t n = leer32(c->ent + i);
+        if (n > SERV_MAX){
+            char linea[128];
+            int k = snprintf(linea, sizeof linea, "[Servidor] Pedido de %lu bytes (maximo %lu)\n",
+                             (unsigned long)n, (unsigned long)SERV_MAX);
+            serv_responder(c, 1, SERV_SIN_REGISTROS, NULL, 0, linea, (size_t)k);
+            c->cerrar = 1;
+            i = c->ent_n;
+            break;
+        }
+        if (c->ent_n - i - 4 < n) break;
+        serv_traducir(s, c, c->ent + i + 4, n);
+        i += 4 + (size_t)n;
+    }
+    memmove(c->ent, c->ent + i, c->ent_n - i);
+    c->ent_n -= i;
+}
+
+/* Lee lo que haya en el socket de c. 0: la conexion se cerro o fallo. */
+static int serv_recibir(Conexion *c){
+    if (c->ent_cap - c->ent_n < SERV_LECTURA){
+        c->ent_cap = c->ent_cap ? c->ent_cap * 2 : 2 * SERV_LECTURA;
+        c->ent = (char*)xrealloc(c->ent, c->ent_cap);
+    }
+    ssize_t r;
+    do r = read(c->fd, c->ent + c->ent_n, c->ent_cap - c->ent_n); while (r < 0 && errno == EINTR);
+    if (r < 0) return errno == EAGAIN || errno == EWOULDBLOCK;
+    if (r == 0) return 0;
+    c->ent_n += (size_t)r;
+    return 1;
+}
+
+/* Envia lo que se pueda de la cola de c. 0: fallo el envio. */
+static int serv_enviar(Conexion *c){
+    while (c->sal_i < c->sal_n){
+        ssize_t w = write(c->fd, c->sal + c->sal_i, c->sal_n - c->sal_i);
+        if (w < 0){
+            if (errno == EINTR) continue;
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+        c->sal_i += (size_t)w;
+    }
+    return 1;
+}
+
+static void sin_bloqueo(int fd){
+    int f = fcntl(fd, F_GETFL, 0);
+    if (f >= 0) fcntl(fd, F_SETFL, f | O_NONBLOCK);
+}
+
+static int serv_direccion(struct sockaddr_un *a, const char *ruta){
+    if (strlen(ruta) >= sizeof a->sun_path){
+        fprintf(stderr, "Ruta de socket demasiado larga: '%s'\n", ruta);
+        return 0;
+    }
+    memset(a, 0, sizeof *a);
+    a->sun_family = AF_UNIX;
+    strcpy(a->sun_path, ruta);
+    return 1;
+}
+
+/* Socket de escucha en ruta. Un socket que quedo de un servidor que ya no
+ * atiende se reemplaza; uno vivo o un archivo que no es socket, no. */
+static int serv_escuchar(const char *ruta){
+    struct sockaddr_un a;
+    if (!serv_direccion(&a, ruta)) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0){ fprintf(stderr, "No se puede crear el socket: %s\n", strerror(errno)); return -1; }
+    int r = bind(fd, (struct sockaddr*)&a, sizeof a);
+    if (r < 0 && errno == EADDRINUSE){
+        struct stat st;
+        int k = socket(AF_UNIX, SOCK_STREAM, 0);
+        int vivo = k >= 0 && connect(k, (struct sockaddr*)&a, sizeof a) == 0;
+        if (k >= 0) close(k);
+        if (!vivo && lstat(ruta, &st) == 0 && S_ISSOCK(st.st_mode) && unlink(ruta) == 0)
+            r = bind(fd, (struct sockaddr*)&a, sizeof a);
+        else errno = EADDRINUSE;
+    }
+    if (r < 0 || listen(fd, SOMAXCONN) < 0){
+        fprintf(stderr, "No se puede escuchar en '%s': %s\n", ruta, strerror(errno));
+        close(fd);
+        return -1;
+    }
+    sin_bloqueo(fd);
+    return fd;
+}
+
+static void serv_cerrar(Conexion *c){
+    close(c->fd);
+    free(c->ent); free(c->sal);
+}
+
+static int servir(const Opciones *op, const char *ruta){
+    int lfd = serv_escuchar(ruta);
+    if (lfd < 0) return 1;
+    struct sigaction sa;
+    memset(&sa, 0, sizeof sa);
+    sa.sa_handler = serv_senal;          /* sin SA_RESTART: poll() vuelve con EINTR */
+    sigaction(SIGINT, &sa, NULL);
+    sigaction(SIGTERM, &sa, NULL);
+    signal(SIGPIPE, SIG_IGN);            /* un cliente que se fue es un write() fallido */
+    idx_implementacion();
+
+    Servidor S;
+    serv_iniciar(&S, op);
+    Conexion *con = (Conexion*)xmalloc(SERV_CONEXIONES * sizeof *con);
+    struct pollfd *pf = (struct pollfd*)xmalloc((SERV_CONEXIONES + 1) * sizeof *pf);
+    size_t ncon = 0;
+    printf("Traductor escuchando en %s (Ctrl+C para terminar)\n", ruta);
+    fflush(stdout);
+
+    while (!serv_parar){
+        pf[0].fd = lfd;
+        pf[0].events = ncon < SERV_CONEXIONES ? POLLIN : 0;
+        for (size_t i = 0; i < ncon; i++){
+            Conexion *c = &con[i];
+            pf[i + 1].fd = c->fd;
+            pf[i + 1].events = 0;
+            if (!c->cerrar && c->sal_n - c->sal_i < SERV_PENDIENTE) pf[i + 1].events |= POLLIN;
+            if (c->sal_i < c->sal_n) pf[i + 1].events |= POLLOUT;
+        }
+        if (poll(pf, ncon + 1, -1) < 0){
+            if (errno == EINTR) continue;
+            fprintf(stderr, "poll: %s\n", strerror(errno));
+            break;
+        }
+        /* atender las conexiones antes de agregar las nuevas: pf sigue sus indices */
+        for (size_t i = 0; i < ncon; i++){
+            Conexion *c = &con[i];
+            short ev = pf[i + 1].revents;
+            int bien = 1;
+            if (ev & (POLLIN | POLLHUP | POLLERR)){
+                if (pf[i + 1].events & POLLIN){
+                    if (!serv_recibir(c)) c->cerrar = 1;
+                    serv_pedidos(&S, c);
+                } else if (ev & POLLERR) bien = 0;
+            }
+            if (bien && c->sal_i < c->sal_n) bien = serv_enviar(c);
+            if (bien && !(c->cerrar && c->sal_i == c->sal_n)) continue;
+            serv_cerrar(c);
+            con[i] = con[--ncon];
+            pf[i + 1] = pf[ncon + 1];
+            i--;
+        }
+        if (pf[0].revents & POLLIN){
+            while (ncon < SERV_CONEXIONES){
+                int fd = accept(lfd, NULL, NULL);
+                if (fd < 0) break;
+                sin_bloqueo(fd);
+                Conexion *c = &con[ncon++];
+                memset(c, 0, sizeof *c);
+                c->fd = fd;
+                S.conexiones++;
+            }
+        }
+    }
+
+    for (size_t i = 0; i < ncon; i++) serv_cerrar(&con[i]);
+    close(lfd);
+    unlink(ruta);
+    printf("Servidor: %zu pedido(s) traducido(s) en %zu conexion(es).\n", S.pedidos, S.conexiones);
+    serv_liberar(&S);
+    free(con); free(pf);
+    return 0;
+}
+
+/* Escribe o lee exactamente n bytes en el socket (bloqueante) */
+static int cli_escribir(int fd, const char *s, size_t n){
+    while (n){
+        ssize_t w = write(fd, s, n);
+        if (w < 0){ if (errno == EINTR) continue; return 0; }
+        s += w; n -= (size_t)w;
+    }
+    return 1;
+}
+static int cli_leer(int fd, char *s, size_t n){
+    while (n){
+        ssize_t r = read(fd, s, n);
+        if (r < 0){ if (errno == EINTR) continue; return 0; }
+        if (r == 0) return 0;
+        s += r; n -= (size_t)r;
+    }
+    return 1;
+}
+
+/* --client: manda la entrada al servidor de ruta y escribe su respuesta:
+ * el XML en out y los mensajes por stderr. Devuelve el codigo de salida. */
+static int cliente(const char *ruta, FILE *in, FILE *out, const char *outname){
+    size_t n = 0, cap = SERV_LECTURA;
+    char *pedido = (char*)xmalloc(cap);
+    for (size_t r; (r = fread(pedido + 4 + n, 1, cap - 4 - n, in)) > 0; ){
+        n += r;
+        if (n == cap - 4){ cap *= 2; pedido = (char*)xrealloc(pedido, cap); }
+    }
+    if (n > SERV_MAX){
+        fprintf(stderr, "Entrada de %zu bytes: el servidor acepta hasta %lu\n", n, (unsigned long)SERV_MAX);
+        free(pedido);
+        return 1;
+    }
+    poner32(pedido, (uint32_t)n);
+
+    struct sockaddr_un a;
+    char cab[SERV_CABECERA];
+    int fd = serv_direccion(&a, ruta) ? socket(AF_UNIX, SOCK_STREAM, 0) : -1;
+    if (fd < 0 || connect(fd, (struct sockaddr*)&a, sizeof a) < 0){
+        fprintf(stderr, "No se puede conectar con '%s': %s\n", ruta, strerror(errno));
+        if (fd >= 0) close(fd);
+        free(pedido);
+        return 1;
+    }
+    int ok = cli_escribir(fd, pedido, 4 + n) && cli_leer(fd, cab, sizeof cab);
+    free(pedido);
+    uint32_t errores = 0, registros = 0, nx = 0, nm = 0;
+    char *resp = NULL;
+    if (ok){
+        errores = leer32(cab); registros = leer32(cab + 4);
+        nx = leer32(cab + 8); nm = leer32(cab + 12);
+        resp = (char*)xmalloc((size_t)nx + nm + 1);
+        ok = cli_leer(fd, resp, (size_t)nx + nm);
+    }
+    close(fd);
+    if (!ok){
+        fprintf(stderr, "El servidor '%s' corto la conexion\n", ruta);
+        free(resp);
+        return 1;
+    }
+    fwrite(resp + nx, 1, nm, stderr);
+    int werr = fwrite(resp, 1, nx, out) != nx || fflush(out) != 0 ? errno : 0;
+    free(resp);
+    if (werr){
+        fprintf(stderr, "Error al escribir '%s': %s\n", outname, strerror(werr));
+        return 1;
+    }
+    FILE *msg = out == stdout ? stderr : stdout;
+    if (registros != SERV_SIN_REGISTROS)
+        fprintf(msg, "%lu registro(s) traducido(s). ", (unsigned long)registros);
+    if (!errores){
+        fprintf(msg, "Traduccion completada. Revisar %s\n", outname);
+        return 0;
+    }
+    fprintf(msg, "Traduccion completada con %lu error(es). Revisar %s (salida parcial) y la consola.\n",
+            (unsigned long)errores, outname);
+    return 2;
+}
+#else
+static int servir(const Opciones *op, const char *ruta){
+    (void)op; (void)ruta;
+    fprintf(stderr, "--serve necesita sockets Unix: no disponible en esta plataforma\n");
+    return 1;
+}
+static int cliente(const char *ruta, FILE *in, FILE *out, const char *outname){
+    (void)ruta; (void)in; (void)out; (void)outname;
+    fprintf(stderr, "--client necesita sockets Unix: no disponible en esta plataforma\n");
+    return 1;
+}
+#endif
+
+static void usage(const char *prog){
+    fprintf(stderr, "Uso: %s [--stream] [-o salida.xml|-] [--max-depth N] [--canonical-numbers] [--tape] [--pointer /ruta] [--select /ruta]... [--arena-stats] [--stats] [--pipeline] [--columnar [--muestra N]] [--parallel [-j N]] <archivo .json o .txt | ->\n", prog);
+    fprintf(stderr, "     %s --batch [-j N] [-o directorio] [opciones] <archivo | directorio | @lista>...\n", prog);
+    fprintf(stderr, "     %s --serve socket [opciones]\n", prog);
+    fprintf(stderr, "     %s --client socket [-o salida.xml|-] <archivo .json o .txt | ->\n", prog);
+    fprintf(stderr, "  --stream  documentos concatenados o NDJSON, uno por registro (salida por defecto: stdout)\n");
+    fprintf(stderr, "  -o        archivo de salida ('-' = stdout; por defecto output.xml)\n");
+    fprintf(stderr, "  --max-depth  anidamiento maximo de objetos/arrays (por defecto %d)\n", MAX_DEPTH_DEF);
+    fprintf(stderr, "  --canonical-numbers  enteros en decimal y reales con las cifras justas (1.50E+2 -> 150)\n");
+    fprintf(stderr, "  --tape    arma el documento en una cinta en memoria y traduce desde ella\n");
+    fprintf(stderr, "  --pointer traduce solo el valor del JSON Pointer dado (p.ej. /personas/0/nombre; usa la cinta)\n");
+    fprintf(stderr, "  --select  traduce solo lo que coincide con la ruta ('*' = cualquier clave o indice);\n");
+    fprintf(stderr, "            se puede repetir; el resto se saltea sin armar tokens (no con --tape/--pointer)\n");
+    fprintf(stderr, "  --stats   tiempos por fase, tokens por tipo, profundidad, asignaciones y bytes en JSON\n");
+    fprintf(stderr, "            por stderr (armar el XML cuenta como sintaxis; salida es la escritura)\n");
+    fprintf(stderr, "  --pipeline  lee y escribe en hilos aparte del parser, con bloques que pasan por\n");
+    fprintf(stderr, "            colas sin locks: la espera de E/S se superpone con la traduccion\n");
+    fprintf(stderr, "  --columnar  en vez de XML, cada array de objetos como una tabla por columnas: un bufer\n");
+    fprintf(stderr, "            por columna, numeros tipados y cadenas con desplazamientos; los arrays dentro\n");
+    fprintf(stderr, "            de una fila son tablas hijas (formato en comun/columnas.h; salida: output.col)\n");
+    fprintf(stderr, "  --muestra N  filas de las que sale el esquema de cada tabla (por defecto %d)\n", COL_MUESTRA);
+    fprintf(stderr, "  --parallel  los elementos de cada array grande (desde 1 MB) se traducen en tandas\n");
+    fprintf(stderr, "            en -j hilos (por defecto uno por procesador); la salida es la misma\n");
+    fprintf(stderr, "            (solo con un archivo regular; no con --stream/--pipeline/--tape/--select/--stats)\n");
+    fprintf(stderr, "  --batch   traduce cada archivo (de un directorio: los .json y .txt; @lista: una ruta por\n");
+    fprintf(stderr, "            linea) a su .xml, junto a la entrada o en el directorio de -o; -j hilos\n");
+    fprintf(stderr, "            (por defecto uno por procesador). Los errores se resumen al final\n");
+    fprintf(stderr, "            (no con --stats/--arena-stats)\n");
+    fprintf(stderr, "  --serve   queda residente y traduce los pedidos que llegan por el socket Unix dado:\n");
+    fprintf(stderr, "            largo (uint32, orden de red) y el JSON; responde errores, registros, largo\n");
+    fprintf(stderr, "            del XML y de los mensajes (uint32) y los dos textos. Con las opciones dadas\n");
+    fprintf(stderr, "            (no con --batch/--pipeline/--parallel/--stats/--arena-stats)\n");
+    fprintf(stderr, "  --client  manda la entrada a un --serve y escribe su respuesta (salida por defecto: stdout)\n");
+}
+
 int main(int argc, char **argv){
-    const char *inpath = NULL;
+    const char *inpath = NULL, *outpath = NULL;
+    int arena_stats = 0, stats = 0, stream = 0, canonical = 0, tape = 0, batch = 0, pipeline = 0;
+    int columnar = 0, parallel = 0;
+    long muestra = COL_MUESTRA;
+    const char *pointer = NULL, *serve = NULL, *client = NULL;
+    Filtro filtro;
+    filtro.n = 0; filtro.raiz = 0;
+    long max_depth = MAX_DEPTH_DEF, hilos = 0;
+    char **rutas = (char**)xmalloc((size_t)argc * sizeof *rutas);
+    size_t nrutas = 0;
 
-    if (argc >= 2) {
-        inpath = argv[1];
-    } else {
+    for (int i = 1; i < argc; i++){
+        if (strcmp(argv[i], "--arena-stats") == 0) arena_stats = 1;
+        else if (strcmp(argv[i], "--stats") == 0) stats = 1;
+        else if (strcmp(argv[i], "--stream") == 0) stream = 1;
+        else if (strcmp(argv[i], "--canonical-numbers") == 0) canonical = 1;
+        else if (strcmp(argv[i], "--tape") == 0) tape = 1;
+        else if (strcmp(argv[i], "--batch") == 0) batch = 1;
+        else if (strcmp(argv[i], "--pipeline") == 0) pipeline = 1;
+        else if (strcmp(argv[i], "--columnar") == 0) columnar = 1;
+        else if (strcmp(argv[i], "--parallel") == 0) parallel = 1;
+        else if (strcmp(argv[i], "--muestra") == 0 && i+1 < argc){
+            muestra = strtol(argv[++i], NULL, 10);
+            if (muestra < 1){ usage(argv[0]); return 1; }
+        }
+        else if (strcmp(argv[i], "--pointer") == 0 && i+1 < argc){ pointer = argv[++i]; tape = 1; }
+        else if (strcmp(argv[i], "--select") == 0 && i+1 < argc){
+            if (!filtro_agregar(&filtro, argv[++i])){ usage(argv[0]); return 1; }
+        }
+        else if (strcmp(argv[i], "--serve") == 0 && i+1 < argc) serve = argv[++i];
+        else if (strcmp(argv[i], "--client") == 0 && i+1 < argc) client = argv[++i];
+        else if (strcmp(argv[i], "-o") == 0 && i+1 < argc) outpath = argv[++i];
+        else if (strcmp(argv[i], "--max-depth") == 0 && i+1 < argc){
+            max_depth = strtol(argv[++i], NULL, 10);
+            if (max_depth < 1){ usage(argv[0]); return 1; }
+        }
+        else if (strcmp(argv[i], "-j") == 0 && i+1 < argc){
+            hilos = strtol(argv[++i], NULL, 10);
+            if (hilos < 1){ usage(argv[0]); return 1; }
+        }
+        else if (argv[i][0] == '-' && argv[i][1] != '\0'){ usage(argv[0]); return 1; }
+        else { rutas[nrutas++] = argv[i]; inpath = argv[i]; }
+    }
+    if (filtro.n && tape){ usage(argv[0]); return 1; }
+    /* --columnar traduce el documento entero desde la cinta */
+    if (columnar && (stream || pointer || filtro.n || batch)){ usage(argv[0]); return 1; }
+    if (columnar) tape = 1;
+    if (parallel && (stream || pipeline || tape || filtro.n || batch || stats)){ usage(argv[0]); return 1; }
+    /* el servidor traduce en memoria, en un solo hilo; el cliente solo manda la entrada */
+    if (serve && (client || batch || pipeline || parallel || stats || arena_stats || nrutas || outpath)){
+        usage(argv[0]); return 1;
+    }
+    if (client && (stream || canonical || tape || batch || pipeline || columnar || parallel ||
+                   filtro.n || stats || arena_stats || nrutas > 1)){
+        usage(argv[0]); return 1;
+    }
+
+    Opciones op;
+    op.stream = stream; op.canonical = canonical; op.tape = tape;
+    op.arena_stats = arena_stats;
+    op.pipeline = pipeline;
+    op.columnar = columnar ? (size_t)muestra : 0;
+    op.paralelo = parallel ? (hilos ? (size_t)hilos : hilo_cpus()) : 0;
+    op.pointer = pointer;
+    op.filtro = filtro.n ? &filtro : NULL;
+    op.max_depth = (size_t)max_depth;
+
+    if (serve){
+        int r = servir(&op, serve);
+        filtro_free(&filtro);
+        free(rutas);
+        return r;
+    }
+    if (batch){
+        if (!nrutas || stats || arena_stats){ usage(argv[0]); return 1; }
+        int r = lote(&op, rutas, nrutas, outpath, hilos ? (size_t)hilos : hilo_cpus());
+        filtro_free(&filtro);
+        free(rutas);
+        return r;
+    }
+    free(rutas);
+
+    if (!inpath) {
         inpath = "fuente.txt";  /* usa fuente.txt si no se pasa nada */
         fprintf(stderr, "Aviso: no se especificó archivo. Usando '%s'.\n", inpath);
     }
+    if (!outpath) outpath = stream || client ? "-" : columnar ? "output.col" : "output.xml";
+    int to_stdout = strcmp(outpath, "-") == 0;
+    const char *outname = to_stdout ? "stdout" : outpath;
 
-    FILE *in = fopen(inpath, "rb");
+    FILE *in = strcmp(inpath, "-") == 0 ? stdin : fopen(inpath, "rb");
     if (!in){
         fprintf(stderr, "No se puede abrir '%s'.\n", inpath);
-        fprintf(stderr, "Uso: %s <archivo .json o .txt>\n", argv[0]);
+        usage(argv[0]);
         return 1;
     }
 
-    FILE *out = fopen("output.xml", "wb");
+    FILE *out = to_stdout ? stdout : fopen(outpath, "wb");
     if (!out){
-        fprintf(stderr, "No se puede abrir 'output.xml' para escribir\n");
-        fclose(in);
+        fprintf(stderr, "No se puede abrir '%s' para escribir\n", outpath);
+        if (in != stdin) fclose(in);
         return 1;
     }
 
-    Parser P;
-    sc_init(&P.sc, in);
-    P.la = next_token(&P.sc);
-    P.out = out;
-    P.errors = 0;
+    if (client){
+        int r = cliente(client, in, out, outname);
+        if (in != stdin) fclose(in);
+        if (out != stdout) fclose(out);
+        return r;
+    }
 
-    json(&P);
+    if (stats && !EST_DISPONIBLE) fprintf(stderr, "Aviso: --stats no disponible (compilado con -DSIN_STATS)\n");
+    if (stats && EST_DISPONIBLE) est_iniciar("traductor", inpath, EST_SINTAXIS);
 
-    token_free(&P.la);
-    fclose(in);
-    fclose(out);
+    Traduccion r = traducir(&op, in, out, NULL);
+    filtro_free(&filtro);
+    if (in != stdin) fclose(in);
+    if (out != stdout) fclose(out);
+    if (r.werr){
+        fprintf(stderr, "Error al escribir '%s': %s\n", outname, strerror(r.werr));
+        return 1;
+    }
 
-    if (P.errors==0){
-        printf("Traduccion completada. Revisar output.xml\n");
+    /* con la salida en stdout los mensajes van a stderr */
+    FILE *msg = to_stdout ? stderr : stdout;
+    if (stream) fprintf(msg, "%zu registro(s) traducido(s). ", r.records);
+    if (r.errors==0){
+        fprintf(msg, "Traduccion completada. Revisar %s\n", outname);
         return 0;
     } else {
-        printf("Traduccion completada con %d error(es). Revisar output.xml (salida parcial) y la consola.\n", P.errors);
+        fprintf(msg, "Traduccion completada con %d error(es). Revisar %s (salida parcial) y la consola.\n", r.errors, outname);
         return 2;
     }
 }
@@ -0,0 +1,41 @@
+/* asignaciones.c - Cuenta las llamadas a malloc, calloc y realloc
+ *
+ * Biblioteca para LD_PRELOAD (Linux/glibc). Al terminar el proceso escribe
+ * la cuenta en el archivo indicado por BENCH_ASIGNACIONES; medir la usa
+ * para reportar asignaciones sin tocar el codigo de las herramientas.
+ *
+ * Compilar: gcc -O2 -shared -fPIC asignaciones.c -o asignaciones.so
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+extern void *__libc_malloc(size_t n);
+extern void *__libc_calloc(size_t n, size_t m);
+extern void *__libc_realloc(void *p, size_t n);
+
+static unsigned long long cuenta = 0;
+
+void *malloc(size_t n){
+    __atomic_fetch_add(&cuenta, 1, __ATOMIC_RELAXED);
+    return __libc_malloc(n);
+}
+void *calloc(size_t n, size_t m){
+    __atomic_fetch_add(&cuenta, 1, __ATOMIC_RELAXED);
+    return __libc_calloc(n, m);
+}
+void *realloc(void *p, size_t n){
+    __atomic_fetch_add(&cuenta, 1, __ATOMIC_RELAXED);
+    return __libc_realloc(p, n);
+}
+
+__attribute__((destructor))
+static void reportar(void){
+    unsigned long long n = __atomic_load_n(&cuenta, __ATOMIC_RELAXED);
+    const char *ruta = getenv("BENCH_ASIGNACIONES");
+    if (!ruta) return;
+    FILE *f = fopen(ruta, "w");
+    if (!f) return;
+    fprintf(f, "%llu\n", n);
+    fclose(f);
+}
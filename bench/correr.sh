@@ -0,0 +1,74 @@
+#!/bin/sh
+# correr.sh - Compila las tres herramientas y el banco de pruebas, genera el
+# corpus estandar y mide. Resultado en bench/_salida/resultados.jsonl.
+#
+# Uso: bench/correr.sh [resultado_anterior.jsonl]
+#   TAMANO=64M REPS=5 bench/correr.sh      (por defecto 32M y 3 repeticiones)
+set -e
+
+cd "$(dirname "$0")/.."
+DIR=bench/_salida
+TAMANO=${TAMANO:-32M}
+REPS=${REPS:-3}
+CC=${CC:-gcc}
+CXX=${CXX:-g++}
+mkdir -p "$DIR"
+
+$CC -O2 -c comun/indice.c -o "$DIR/indice.o"
+$CC -O2 -c comun/lexico.c -o "$DIR/lexico.o"
+$CC -O2 -c comun/numero.c -o "$DIR/numero.o"
+$CC -O2 -c comun/cinta.c -o "$DIR/cinta.o"
+$CC -O2 -c comun/columnas.c -o "$DIR/columnas.o"
+$CC -O2 -c comun/estadisticas.c -o "$DIR/estadisticas.o"
+$CC -O2 -c comun/hilos.c -o "$DIR/hilos.o"
+$CC -O2 -c comun/flujo.c -o "$DIR/flujo.o"
+$CC -O2 -c comun/utf8.c -o "$DIR/utf8.o"
+$CC -O2 main.c lexer.c "$DIR/indice.o" "$DIR/lexico.o" "$DIR/estadisticas.o" "$DIR/flujo.o" -o "$DIR/lexer"
+$CXX -O2 Tarea_2/main.cpp "$DIR/indice.o" "$DIR/lexico.o" "$DIR/estadisticas.o" "$DIR/flujo.o" "$DIR/utf8.o" -o "$DIR/sintactico"
+$CC -O2 -pthread Tarea_3/traductor.c "$DIR/indice.o" "$DIR/lexico.o" "$DIR/numero.o" "$DIR/cinta.o" "$DIR/columnas.o" "$DIR/estadisticas.o" "$DIR/hilos.o" -o "$DIR/traductor"
+$CC -O2 bench/generar.c -o "$DIR/generar"
+$CC -O2 bench/medir.c "$DIR/lexico.o" -o "$DIR/medir"
+ASIG=
+if $CC -O2 -shared -fPIC bench/asignaciones.c -o "$DIR/asignaciones.so" 2>/dev/null; then
+    ASIG="--asignaciones $PWD/$DIR/asignaciones.so"
+fi
+
+# nombre y opciones del generador; "base" es la forma de Tarea_3/fuente.txt
+G="$DIR/generar --tamano $TAMANO"
+$G                                         -o "$DIR/base.json"
+$G --profundidad 200 --ancho 1 --sangria 0 -o "$DIR/profundo.json"
+$G --ancho 64 --profundidad 2              -o "$DIR/ancho.json"
+$G --mezcla numeros                        -o "$DIR/numeros.json"
+$G --mezcla cadenas --cadena 120           -o "$DIR/cadenas.json"
+$G --mezcla cadenas --escapes 10           -o "$DIR/escapes.json"
+
+# El sintactico tiene que dar lo mismo leyendo el texto que con los tokens
+# de lexer --tokens (comun/flujo.h): los dos cortan las cadenas igual
+# (lx_cadena_linea) y cuentan las mismas lineas. Ademas del corpus, cadenas
+# cortadas por un salto, escapado o no, y una barra al final.
+printf '{"r":{"\nk0":{}}}' > "$DIR/salto.json"
+printf '{"a\\\nb":1,\n"c":"d\\' > "$DIR/escape.json"
+printf '[1,\r\n"x\n",tru]\n' > "$DIR/crlf.json"
+for f in "$DIR"/*.json; do
+    "$DIR/sintactico" "$f" > "$DIR/texto.txt"
+    "$DIR/lexer" --tokens "$f" /dev/null
+    "$DIR/sintactico" --tokens "$f.tok" "$f" > "$DIR/tokens.txt"
+    rm -f "$f.tok"
+    if ! cmp -s "$DIR/texto.txt" "$DIR/tokens.txt"; then
+        echo "sintactico: $f da otro resultado con lexer --tokens" >&2
+        exit 4
+    fi
+done
+rm -f "$DIR/texto.txt" "$DIR/tokens.txt"
+
+COMPARAR=
+[ -n "$1" ] && COMPARAR="--comparar $1"
+
+"$DIR/medir" --reps "$REPS" $ASIG $COMPARAR \
+    --lexer "$DIR/lexer" \
+    --sintactico "$DIR/sintactico" \
+    --traductor "$DIR/traductor -o /dev/null" \
+    "$DIR/base.json" "$DIR/profundo.json" "$DIR/ancho.json" \
+    "$DIR/numeros.json" "$DIR/cadenas.json" "$DIR/escapes.json" \
+    > "$DIR/resultados.jsonl"
+cat "$DIR/resultados.jsonl"
@@ -0,0 +1,281 @@
+/* generar.c - Generador determinista de corpus JSON para los benchmarks
+ *
+ * Produce registros con la forma de Tarea_3/fuente.txt ({"personas":[...]}
+ * con ci, nombre, casado e hijos) hasta llegar al tamano pedido. La misma
+ * semilla y las mismas opciones dan siempre el mismo archivo, en cualquier
+ * plataforma (generador propio, no rand()).
+ *
+ * Compilar: gcc -O2 generar.c -o generar
+ * Uso: generar [opciones] > corpus.json
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+typedef enum { MEZCLA_MIXTA, MEZCLA_NUMEROS, MEZCLA_CADENAS } Mezcla;
+
+typedef struct {
+    uint64_t tamano;      /* bytes objetivo */
+    int profundidad;      /* niveles de hijos bajo cada persona */
+    int ancho;            /* hijos por array: entre (ancho+1)/2 y ancho */
+    int cadena;           /* largo aproximado de los textos (0 = nombres reales) */
+    int escapes;          /* % de caracteres de texto precedidos por un escape */
+    Mezcla mezcla;
+    uint64_t semilla;
+    int sangria;          /* espacios por nivel */
+    int ndjson;           /* un registro por linea, sin envoltorio */
+} Opciones;
+
+static FILE *out;
+static uint64_t escritos = 0;
+
+/*--- PRNG: splitmix64 ---*/
+static uint64_t estado;
+static uint64_t aleatorio(void){
+    uint64_t z = (estado += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+/* entero en [0, n) */
+static unsigned hasta(unsigned n){ return n ? (unsigned)(aleatorio() % n) : 0; }
+
+/*--- salida ---*/
+static void poner(const char *s, size_t n){
+    fwrite(s, 1, n, out);
+    escritos += n;
+}
+static void texto(const char *s){ poner(s, strlen(s)); }
+static void sangria(const Opciones *o, int nivel){
+    static const char blancos[] = "                                                                ";
+    if (o->ndjson) return;
+    poner("\n", 1);
+    size_t n = (size_t)nivel * (size_t)o->sangria;
+    while (n){
+        size_t k = n < sizeof blancos - 1 ? n : sizeof blancos - 1;
+        poner(blancos, k);
+        n -= k;
+    }
+}
+static void entero(long long v){
+    char b[32];
+    poner(b, (size_t)snprintf(b, sizeof b, "%lld", v));
+}
+
+static const char *nombres[] = {
+    "Julio", "Juan", "Jorge", "Valeria", "Camila", "Noelia", "Bruno", "Ana",
+    "Luis", "María", "José", "Lucía", "Pedro", "Sofía", "Diego", "Elena"
+};
+static const char *apellidos[] = {
+    "Pérez", "Gómez", "Duarte", "Insfrán", "Brizuela", "Ramos", "Benítez",
+    "González", "Martínez", "Ortiz", "Acosta", "Giménez", "Núñez", "Vera"
+};
+#define CANT(a) (sizeof(a) / sizeof((a)[0]))
+
+static const char *secuencias[] = { "\\\"", "\\\\", "\\n", "\\t", "\\/", "\\u00e9" };
+
+/* "Nombre Apellido", alargado con mas palabras hasta o->cadena bytes; con
+ * o->escapes se intercalan secuencias de escape. */
+static void cadena(const Opciones *o){
+    char raw[4096];
+    size_t n = (size_t)snprintf(raw, sizeof raw, "%s %s",
+                                nombres[hasta(CANT(nombres))], apellidos[hasta(CANT(apellidos))]);
+    while (n < (size_t)o->cadena && n + 32 < sizeof raw){
+        const char *w = hasta(2) ? nombres[hasta(CANT(nombres))] : apellidos[hasta(CANT(apellidos))];
+        n += (size_t)snprintf(raw + n, sizeof raw - n, " %s", w);
+    }
+    poner("\"", 1);
+    if (!o->escapes) poner(raw, n);
+    else {
+        for (size_t i = 0; i < n; i++){
+            /* nunca en medio de un caracter UTF-8 de varios bytes */
+            if (((unsigned char)raw[i] & 0xC0) != 0x80 && hasta(100) < (unsigned)o->escapes)
+                texto(secuencias[hasta(CANT(secuencias))]);
+            poner(raw + i, 1);
+        }
+    }
+    poner("\"", 1);
+}
+
+/* decimal con signo y a veces exponente: -1234.56, 6.02e23, 0.5 */
+static void real(void){
+    char b[48];
+    long long ent = (long long)hasta(100000);
+    unsigned dec = hasta(100);
+    const char *signo = hasta(4) ? "" : "-";
+    size_t n;
+    if (hasta(3)) n = (size_t)snprintf(b, sizeof b, "%s%lld.%02u", signo, ent, dec);
+    else n = (size_t)snprintf(b, sizeof b, "%s%u.%02ue%s%u", signo, hasta(10), dec,
+                              hasta(2) ? "-" : "+", hasta(300));
+    poner(b, n);
+}
+
+static void clave(const Opciones *o, int nivel, const char *k, int primera){
+    if (!primera) poner(",", 1);
+    sangria(o, nivel);
+    poner("\"", 1); texto(k); poner("\":", 2);
+}
+
+/* Campos extra segun la mezcla pedida */
+static void campos_extra(const Opciones *o, int nivel){
+    if (o->mezcla == MEZCLA_NUMEROS){
+        clave(o, nivel, "peso", 0);   real();
+        clave(o, nivel, "saldo", 0);  real();
+        clave(o, nivel, "puntos", 0);
+        poner("[", 1);
+        unsigned k = 4 + hasta(8);
+        for (unsigned i = 0; i < k; i++){
+            if (i) poner(",", 1);
+            if (hasta(2)) entero((long long)hasta(1000000) - 500000); else real();
+        }
+        poner("]", 1);
+    } else if (o->mezcla == MEZCLA_CADENAS){
+        clave(o, nivel, "direccion", 0); cadena(o);
+        clave(o, nivel, "correo", 0);    cadena(o);
+        clave(o, nivel, "apodos", 0);
+        poner("[", 1);
+        unsigned k = 1 + hasta(4);
+        for (unsigned i = 0; i < k; i++){
+            if (i) poner(",", 1);
+            cadena(o);
+        }
+        poner("]", 1);
+    }
+}
+
+static void hijos(const Opciones *o, int nivel, int resto);
+
+/* {"nombre":...,"edad":...[,"hijos":[...]]} */
+static void hijo(const Opciones *o, int nivel, int resto){
+    poner("{  ", o->ndjson ? 1 : 3);
+    clave(o, nivel + 1, "nombre", 1); cadena(o);
+    clave(o, nivel + 1, "edad", 0);   entero(hasta(90));
+    campos_extra(o, nivel + 1);
+    if (resto > 0){
+        clave(o, nivel + 1, "hijos", 0);
+        hijos(o, nivel + 1, resto - 1);
+    }
+    sangria(o, nivel);
+    poner("}", 1);
+}
+
+/* Array de hijos; se corta si ya se llego al tamano pedido, asi un ancho y
+ * una profundidad grandes no hacen crecer un registro sin limite. */
+static void hijos(const Opciones *o, int nivel, int resto){
+    unsigned min = (unsigned)(o->ancho + 1) / 2;
+    unsigned k = min + hasta((unsigned)o->ancho - min + 1);
+    if (escritos >= o->tamano) k = 0;
+    poner("[  ", o->ndjson ? 1 : 3);
+    for (unsigned i = 0; i < k; i++){
+        if (i) poner(",", 1);
+        sangria(o, nivel + 1);
+        hijo(o, nivel + 1, resto);
+    }
+    if (!k && !o->ndjson) poner("\n", 1);
+    sangria(o, nivel);
+    poner("]", 1);
+}
+
+static void persona(const Opciones *o, int nivel){
+    poner("{  ", o->ndjson ? 1 : 3);
+    clave(o, nivel + 1, "ci", 1);       entero(1000000 + (long long)hasta(9000000));
+    clave(o, nivel + 1, "nombre", 0);   cadena(o);
+    clave(o, nivel + 1, "casado", 0);   texto(hasta(2) ? "true" : "false");
+    campos_extra(o, nivel + 1);
+    clave(o, nivel + 1, "hijos", 0);
+    hijos(o, nivel + 1, o->profundidad - 1);
+    sangria(o, nivel);
+    poner("}", 1);
+}
+
+static uint64_t leer_tamano(const char *s){
+    char *fin;
+    double v = strtod(s, &fin);
+    switch (*fin){
+        case 'k': case 'K': v *= 1024; break;
+        case 'm': case 'M': v *= 1024 * 1024; break;
+        case 'g': case 'G': v *= 1024.0 * 1024 * 1024; break;
+    }
+    return v > 0 ? (uint64_t)v : 0;
+}
+
+static void uso(const char *prog){
+    fprintf(stderr, "Uso: %s [opciones] [-o archivo]\n", prog);
+    fprintf(stderr, "  --tamano N       bytes aproximados (sufijos K, M, G; por defecto 10M)\n");
+    fprintf(stderr, "  --profundidad N  niveles de hijos (por defecto 1, como fuente.txt)\n");
+    fprintf(stderr, "  --ancho N        hijos por array, entre (N+1)/2 y N (por defecto 2)\n");
+    fprintf(stderr, "  --cadena N       largo aproximado de los textos (por defecto 0: nombres)\n");
+    fprintf(stderr, "  --escapes P      %% de caracteres de texto con una secuencia de escape\n");
+    fprintf(stderr, "  --mezcla M       mixta | numeros | cadenas (por defecto mixta)\n");
+    fprintf(stderr, "  --semilla S      semilla del generador (por defecto 1)\n");
+    fprintf(stderr, "  --sangria N      espacios por nivel de anidamiento (por defecto 3)\n");
+    fprintf(stderr, "  --ndjson         un registro por linea, sin {\"personas\":[...]}\n");
+}
+
+int main(int argc, char *argv[]){
+    Opciones o = { 10u << 20, 1, 2, 0, 0, MEZCLA_MIXTA, 1, 3, 0 };
+    const char *salida = NULL;
+    for (int i = 1; i < argc; i++){
+        const char *a = argv[i], *v = i + 1 < argc ? argv[i + 1] : NULL;
+        if (strcmp(a, "--ndjson") == 0){ o.ndjson = 1; continue; }
+        if (!v){ uso(argv[0]); return 1; }
+        i++;
+        if (strcmp(a, "--tamano") == 0) o.tamano = leer_tamano(v);
+        else if (strcmp(a, "--profundidad") == 0) o.profundidad = atoi(v);
+        else if (strcmp(a, "--ancho") == 0) o.ancho = atoi(v);
+        else if (strcmp(a, "--cadena") == 0) o.cadena = atoi(v);
+        else if (strcmp(a, "--escapes") == 0) o.escapes = atoi(v);
+        else if (strcmp(a, "--sangria") == 0) o.sangria = atoi(v);
+        else if (strcmp(a, "--semilla") == 0) o.semilla = strtoull(v, NULL, 10);
+        else if (strcmp(a, "-o") == 0) salida = v;
+        else if (strcmp(a, "--mezcla") == 0){
+            if (strcmp(v, "mixta") == 0) o.mezcla = MEZCLA_MIXTA;
+            else if (strcmp(v, "numeros") == 0) o.mezcla = MEZCLA_NUMEROS;
+            else if (strcmp(v, "cadenas") == 0) o.mezcla = MEZCLA_CADENAS;
+            else { uso(argv[0]); return 1; }
+        } else { uso(argv[0]); return 1; }
+    }
+    if (o.profundidad < 1 || o.ancho < 0 || o.cadena < 0 || o.escapes < 0 || o.escapes > 100 ||
+        o.sangria < 0){
+        uso(argv[0]);
+        return 1;
+    }
+
+    out = salida ? fopen(salida, "wb") : stdout;
+    if (!out){
+        fprintf(stderr, "No se pudo crear %s\n", salida);
+        return 1;
+    }
+    static char buf[1 << 16];
+    setvbuf(out, buf, _IOFBF, sizeof buf);
+    estado = o.semilla;
+
+    if (o.ndjson){
+        do {
+            persona(&o, 0);
+            poner("\n", 1);
+        } while (escritos < o.tamano);
+    } else {
+        texto("{  ");
+        sangria(&o, 1);
+        texto("\"personas\":[  ");
+        int primera = 1;
+        do {
+            if (!primera) poner(",", 1);
+            primera = 0;
+            sangria(&o, 2);
+            persona(&o, 2);
+        } while (escritos < o.tamano);
+        sangria(&o, 1);
+        texto("]");
+        sangria(&o, 0);
+        texto("}\n");
+    }
+    if (fflush(out) != 0 || (salida && fclose(out) != 0)){
+        fprintf(stderr, "Error al escribir la salida\n");
+        return 1;
+    }
+    return 0;
+}
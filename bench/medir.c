@@ -0,0 +1,283 @@
+/* medir.c - Corre las herramientas sobre un corpus y reporta su rendimiento
+ *
+ * Por cada corpus y herramienta ejecuta N repeticiones y escribe en stdout
+ * una linea JSON con: bytes, tokens, mejor tiempo, MB/s (10^6 bytes),
+ * tokens/s, RSS maximo y, si se da la biblioteca de asignaciones.c, la
+ * cantidad de malloc/calloc/realloc. Los tokens se cuentan una vez con el
+ * lexer comun (comun/lexico.h), igual para las tres herramientas.
+ *
+ * Con --comparar se lee un resultado anterior y se termina con codigo 3 si
+ * alguna herramienta bajo de MB/s mas que la tolerancia.
+ *
+ * Solo POSIX (fork/exec/wait4): Linux, macOS o MSYS2/WSL en Windows.
+ * Compilar: gcc -O2 medir.c ../comun/lexico.c -o medir
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include "../comun/lexico.h"
+
+#define MAX_ARGS 32
+
+typedef struct {
+    const char *nombre;       /* lexer, sintactico, traductor */
+    char *argv[MAX_ARGS];     /* comando y opciones; el corpus se agrega despues */
+    int argc;
+} Herramienta;
+
+typedef struct {
+    double seg;               /* mejor tiempo de pared */
+    long rss_kb;              /* RSS maximo entre las repeticiones */
+    long long asignaciones;   /* -1 si no se midieron */
+    int codigo;               /* codigo de salida de la ultima repeticion */
+} Medida;
+
+/*--- corpus ---*/
+/* Cuenta los tokens del corpus con el lexer comun, leyendo de a bloques:
+ * la memoria del proceso queda chica y no se hereda en el RSS de los hijos
+ * (fork copia la marca de RSS maximo del padre). -1 si no se pudo leer. */
+static long long contar_tokens(const char *ruta, size_t *bytes){
+    enum { FUERA, CADENA, ESCAPE, ESCALAR } modo = FUERA;
+    static char s[1 << 16];
+    unsigned char e = LXA_INICIO;
+    long long t = 0;
+    size_t n;
+    FILE *f = fopen(ruta, "rb");
+    if (!f) return -1;
+    *bytes = 0;
+    while ((n = fread(s, 1, sizeof s, f)) > 0){
+        size_t i = 0;
+        *bytes += n;
+        while (i < n){
+            if (modo == ESCAPE){ i++; modo = CADENA; continue; }
+            if (modo == CADENA){
+                i += lx_cadena(s + i, n - i);
+                if (i < n) modo = s[i++] == '"' ? FUERA : ESCAPE;
+                continue;
+            }
+            if (modo == ESCALAR){
+                i += lx_escalar(&e, s + i, n - i);
+                if (i < n) modo = FUERA;
+                continue;
+            }
+            unsigned c = lx_clase[(unsigned char)s[i]];
+            if (c == LXC_BLANCO || c == LXC_SALTO){ i++; continue; }
+            t++;
+            if (c <= LXC_DOS_PUNTOS) i++;
+            else if (c == LXC_COMILLA){ i++; modo = CADENA; }
+            else { e = LXA_INICIO; modo = ESCALAR; }
+        }
+    }
+    fclose(f);
+    return t;
+}
+
+/*--- ejecucion ---*/
+static double ahora(void){
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+/* Corre la herramienta sobre el corpus con stdout/stderr a /dev/null.
+ * Devuelve el codigo de salida (128+senal si murio) y llena seg y rss. */
+static int ejecutar(const Herramienta *h, const char *corpus, const char *precarga,
+                    const char *cuenta, double *seg, long *rss_kb){
+    char *argv[MAX_ARGS + 3];
+    int argc = 0;
+    for (int i = 0; i < h->argc; i++) argv[argc++] = h->argv[i];
+    argv[argc++] = (char*)corpus;
+    if (strcmp(h->nombre, "lexer") == 0) argv[argc++] = (char*)"/dev/null";
+    argv[argc] = NULL;
+
+    double t0 = ahora();
+    pid_t pid = fork();
+    if (pid < 0){ perror("fork"); exit(1); }
+    if (pid == 0){
+        int nulo = open("/dev/null", O_WRONLY);
+        if (nulo >= 0){ dup2(nulo, 1); dup2(nulo, 2); close(nulo); }
+        if (precarga){
+            setenv("LD_PRELOAD", precarga, 1);
+            setenv("BENCH_ASIGNACIONES", cuenta, 1);
+        }
+        execvp(argv[0], argv);
+        _exit(127);
+    }
+    int st;
+    struct rusage ru;
+    if (wait4(pid, &st, 0, &ru) < 0){ perror("wait4"); exit(1); }
+    *seg = ahora() - t0;
+#ifdef __APPLE__
+    *rss_kb = ru.ru_maxrss / 1024;
+#else
+    *rss_kb = ru.ru_maxrss;
+#endif
+    return WIFEXITED(st) ? WEXITSTATUS(st) : 128 + WTERMSIG(st);
+}
+
+static Medida medir(const Herramienta *h, const char *corpus, int reps, const char *precarga){
+    Medida m = { 1e30, 0, -1, 0 };
+    for (int r = 0; r < reps; r++){
+        double seg; long rss;
+        m.codigo = ejecutar(h, corpus, NULL, NULL, &seg, &rss);
+        if (seg < m.seg) m.seg = seg;
+        if (rss > m.rss_kb) m.rss_kb = rss;
+    }
+    if (precarga){
+        /* una corrida aparte: la biblioteca no debe pesar en los tiempos */
+        char cuenta[] = "/tmp/medir_asignacionesXXXXXX";
+        int fd = mkstemp(cuenta);
+        if (fd >= 0){
+            double seg; long rss;
+            close(fd);
+            ejecutar(h, corpus, precarga, cuenta, &seg, &rss);
+            FILE *f = fopen(cuenta, "r");
+            if (f){
+                if (fscanf(f, "%lld", &m.asignaciones) != 1) m.asignaciones = -1;
+                fclose(f);
+            }
+            unlink(cuenta);
+        }
+    }
+    return m;
+}
+
+/*--- resultados ---*/
+static const char *base_nombre(const char *ruta){
+    const char *b = strrchr(ruta, '/');
+    return b ? b + 1 : ruta;
+}
+
+/* Valor del campo "clave" en una linea JSON escrita por este programa */
+static int campo_texto(const char *linea, const char *clave, char *out, size_t cap){
+    char pat[64];
+    snprintf(pat, sizeof pat, "\"%s\":\"", clave);
+    const char *p = strstr(linea, pat);
+    if (!p) return 0;
+    p += strlen(pat);
+    size_t n = 0;
+    while (*p && *p != '"' && n + 1 < cap){
+        if (*p == '\\' && p[1]) p++;
+        out[n++] = *p++;
+    }
+    out[n] = '\0';
+    return 1;
+}
+static int campo_numero(const char *linea, const char *clave, double *v){
+    char pat[64];
+    snprintf(pat, sizeof pat, "\"%s\":", clave);
+    const char *p = strstr(linea, pat);
+    if (!p) return 0;
+    *v = strtod(p + strlen(pat), NULL);
+    return 1;
+}
+
+/* MB/s del resultado anterior para (herramienta, corpus), o -1 */
+static double previo_mb_s(const char *ruta, const char *herramienta, const char *corpus){
+    FILE *f = ruta ? fopen(ruta, "r") : NULL;
+    if (!f) return -1;
+    char linea[1024], h[64], c[512];
+    double v = -1;
+    while (fgets(linea, sizeof linea, f)){
+        if (campo_texto(linea, "herramienta", h, sizeof h) && strcmp(h, herramienta) == 0 &&
+            campo_texto(linea, "corpus", c, sizeof c) && strcmp(c, corpus) == 0)
+            campo_numero(linea, "mb_s", &v);
+    }
+    fclose(f);
+    return v;
+}
+
+static void json_texto(const char *s){
+    putchar('"');
+    for (; *s; s++){
+        if (*s == '"' || *s == '\\') putchar('\\');
+        putchar(*s);
+    }
+    putchar('"');
+}
+
+static void uso(const char *prog){
+    fprintf(stderr, "Uso: %s [opciones] corpus...\n", prog);
+    fprintf(stderr, "  --lexer CMD         Tarea 1 (se corre como: CMD corpus /dev/null)\n");
+    fprintf(stderr, "  --sintactico CMD    Tarea 2 (CMD corpus)\n");
+    fprintf(stderr, "  --traductor CMD     Tarea 3 (CMD corpus; p.ej. \"traductor -o /dev/null\")\n");
+    fprintf(stderr, "  --reps N            repeticiones por medida, se toma la mejor (por defecto 3)\n");
+    fprintf(stderr, "  --asignaciones LIB  asignaciones.so para contar malloc/calloc/realloc\n");
+    fprintf(stderr, "  --comparar ARCHIVO  resultado anterior: codigo 3 si hay regresiones\n");
+    fprintf(stderr, "  --tolerancia P      %% de MB/s que se tolera perder (por defecto 10)\n");
+}
+
+/* CMD admite opciones separadas por espacios */
+static void partir(Herramienta *h, const char *nombre, char *cmd){
+    h->nombre = nombre;
+    h->argc = 0;
+    for (char *t = strtok(cmd, " "); t && h->argc < MAX_ARGS; t = strtok(NULL, " "))
+        h->argv[h->argc++] = t;
+}
+
+int main(int argc, char *argv[]){
+    Herramienta hs[3];
+    int nh = 0, reps = 3, primero = argc;
+    const char *precarga = NULL, *comparar = NULL;
+    double tolerancia = 10;
+
+    for (int i = 1; i < argc; i++){
+        const char *a = argv[i];
+        if (a[0] != '-'){ primero = i; break; }
+        if (i + 1 >= argc){ uso(argv[0]); return 1; }
+        char *v = argv[++i];
+        int es_herramienta = !strcmp(a, "--lexer") || !strcmp(a, "--sintactico") ||
+                             !strcmp(a, "--traductor");
+        if (es_herramienta && nh == 3){ uso(argv[0]); return 1; }
+        if (strcmp(a, "--lexer") == 0) partir(&hs[nh++], "lexer", v);
+        else if (strcmp(a, "--sintactico") == 0) partir(&hs[nh++], "sintactico", v);
+        else if (strcmp(a, "--traductor") == 0) partir(&hs[nh++], "traductor", v);
+        else if (strcmp(a, "--reps") == 0) reps = atoi(v);
+        else if (strcmp(a, "--asignaciones") == 0) precarga = v;
+        else if (strcmp(a, "--comparar") == 0) comparar = v;
+        else if (strcmp(a, "--tolerancia") == 0) tolerancia = atof(v);
+        else { uso(argv[0]); return 1; }
+    }
+    if (!nh || primero >= argc || reps < 1){ uso(argv[0]); return 1; }
+
+    int regresiones = 0;
+    for (int c = primero; c < argc; c++){
+        size_t bytes;
+        long long tokens = contar_tokens(argv[c], &bytes);
+        if (tokens < 0){
+            fprintf(stderr, "No se pudo leer %s\n", argv[c]);
+            return 1;
+        }
+
+        const char *corpus = base_nombre(argv[c]);
+        for (int k = 0; k < nh; k++){
+            Medida m = medir(&hs[k], argv[c], reps, precarga);
+            double mb_s = bytes / m.seg / 1e6;
+            printf("{\"herramienta\":"); json_texto(hs[k].nombre);
+            printf(",\"corpus\":"); json_texto(corpus);
+            printf(",\"bytes\":%zu,\"tokens\":%lld,\"reps\":%d,\"seg\":%.6f"
+                   ",\"mb_s\":%.2f,\"tokens_s\":%.0f,\"rss_kb\":%ld,\"asignaciones\":%lld"
+                   ",\"codigo\":%d}\n",
+                   bytes, tokens, reps, m.seg,
+                   mb_s, tokens / m.seg, m.rss_kb, m.asignaciones, m.codigo);
+            fflush(stdout);
+
+            double antes = previo_mb_s(comparar, hs[k].nombre, corpus);
+            if (antes > 0 && mb_s < antes * (1 - tolerancia / 100)){
+                fprintf(stderr, "REGRESION %s %s: %.2f -> %.2f MB/s (%.1f%%)\n",
+                        hs[k].nombre, corpus, antes, mb_s, (mb_s / antes - 1) * 100);
+                regresiones++;
+            }
+        }
+    }
+    return regresiones ? 3 : 0;
+}
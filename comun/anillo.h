@@ -0,0 +1,68 @@
+/* anillo.h - Cola acotada de un productor y un consumidor, sin locks
+ *
+ * Un arreglo circular de punteros con dos contadores que solo crecen:
+ * escribir lo mueve solo el productor y leer solo el consumidor, cada uno
+ * en su linea de cache. El que publica usa release y el que mira el
+ * contador del otro acquire, asi lo escrito en el elemento se ve antes
+ * que el elemento. La capacidad es potencia de 2.
+ */
+#ifndef ANILLO_H
+#define ANILLO_H
+
+#include <stddef.h>
+#include "hilos.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    void **ranura;
+    size_t mascara;
+    char r0[64];
+    size_t escribir;   /* del productor */
+    char r1[64];
+    size_t leer;       /* del consumidor */
+    char r2[64];
+} Anillo;
+
+/* ranuras: cap punteros (cap potencia de 2) que el llamador mantiene vivos */
+static inline void anillo_iniciar(Anillo *a, void **ranuras, size_t cap){
+    a->ranura = ranuras; a->mascara = cap - 1;
+    a->escribir = a->leer = 0;
+}
+/* 0 si esta llena */
+static inline int anillo_poner(Anillo *a, void *x){
+    size_t e = a->escribir, l = __atomic_load_n(&a->leer, __ATOMIC_ACQUIRE);
+    if (e - l > a->mascara) return 0;
+    a->ranura[e & a->mascara] = x;
+    __atomic_store_n(&a->escribir, e + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+/* NULL si esta vacia */
+static inline void *anillo_sacar(Anillo *a){
+    size_t l = a->leer, e = __atomic_load_n(&a->escribir, __ATOMIC_ACQUIRE);
+    if (l == e) return NULL;
+    void *x = a->ranura[l & a->mascara];
+    __atomic_store_n(&a->leer, l + 1, __ATOMIC_RELEASE);
+    return x;
+}
+static inline int anillo_vacio(Anillo *a){
+    return a->leer == __atomic_load_n(&a->escribir, __ATOMIC_ACQUIRE);
+}
+static inline void anillo_esperar_poner(Anillo *a, void *x){
+    unsigned n = 0;
+    while (!anillo_poner(a, x)) hilo_pausa(&n);
+}
+static inline void *anillo_esperar_sacar(Anillo *a){
+    unsigned n = 0;
+    void *x;
+    while (!(x = anillo_sacar(a))) hilo_pausa(&n);
+    return x;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,127 @@
+/* cinta.c - ver cinta.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "cinta.h"
+#include "estadisticas.h"
+
+static void *crecer(void *p, size_t *cap, size_t min, size_t tam){
+    size_t n = *cap ? *cap : 64;
+    while (n < min) n *= 2;
+    if (n == *cap) return p;
+    EST(est_asignacion(n * tam));
+    p = realloc(p, n * tam);
+    if (!p){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    *cap = n;
+    return p;
+}
+
+void cinta_init(Cinta *c){
+    c->t = NULL; c->n = c->cap = 0;
+    c->cad = NULL; c->cad_n = c->cad_cap = 0;
+    c->abiertos = NULL; c->prof = c->prof_cap = 0;
+}
+void cinta_free(Cinta *c){
+    free(c->t); free(c->cad); free(c->abiertos);
+    cinta_init(c);
+}
+void cinta_vaciar(Cinta *c){ c->n = 0; c->cad_n = 0; c->prof = 0; }
+
+static inline void poner(Cinta *c, char tipo, uint64_t dato){
+    if (c->n == c->cap) c->t = (uint64_t*)crecer(c->t, &c->cap, c->n + 1, sizeof *c->t);
+    c->t[c->n++] = ((uint64_t)(unsigned char)tipo << 56) | dato;
+}
+/* copia s en cad con su largo adelante y '\0' al final */
+static uint64_t guardar(Cinta *c, const char *s, size_t n){
+    uint32_t len = (uint32_t)n;
+    size_t at = c->cad_n;
+    if (at + sizeof len + n + 1 > c->cad_cap)
+        c->cad = (char*)crecer(c->cad, &c->cad_cap, at + sizeof len + n + 1, 1);
+    memcpy(c->cad + at, &len, sizeof len);
+    if (n) memcpy(c->cad + at + sizeof len, s, n);
+    c->cad[at + sizeof len + n] = '\0';
+    c->cad_n = at + sizeof len + n + 1;
+    return at;
+}
+
+void cinta_abrir(Cinta *c, char tipo){
+    if (c->prof == c->prof_cap)
+        c->abiertos = (size_t*)crecer(c->abiertos, &c->prof_cap, c->prof + 1, sizeof *c->abiertos);
+    c->abiertos[c->prof++] = c->n;
+    poner(c, tipo, 0);                 /* el cierre se completa en cinta_cerrar */
+}
+void cinta_cerrar(Cinta *c){
+    size_t a = c->abiertos[--c->prof];
+    char tipo = cinta_tipo(c, a) == '{' ? '}' : ']';
+    c->t[a] |= (uint64_t)c->n;
+    poner(c, tipo, a);
+}
+char cinta_abierto(const Cinta *c){
+    return c->prof ? cinta_tipo(c, c->abiertos[c->prof - 1]) : 0;
+}
+void cinta_cadena(Cinta *c, const char *s, size_t n){
+    poner(c, '"', guardar(c, s, n));
+}
+void cinta_numero(Cinta *c, const char *lex, size_t n, const Numero *v){
+    uint64_t crudo;
+    if (v->tipo == NUM_ENTERO) memcpy(&crudo, &v->entero, sizeof crudo);
+    else memcpy(&crudo, &v->real, sizeof crudo);
+    poner(c, v->tipo == NUM_ENTERO ? 'l' : 'd', guardar(c, lex, n));
+    if (c->n == c->cap) c->t = (uint64_t*)crecer(c->t, &c->cap, c->n + 1, sizeof *c->t);
+    c->t[c->n++] = crudo;
+}
+void cinta_literal(Cinta *c, char tipo){ poner(c, tipo, 0); }
+
+/*--- JSON Pointer ---*/
+/* Segmento s[0..n) sin escapar comparado con la clave k[0..kn) */
+static int segmento_igual(const char *s, size_t n, const char *k, size_t kn){
+    size_t i = 0, j = 0;
+    for (; i < n; i++, j++){
+        char ch = s[i];
+        if (ch == '~' && i + 1 < n && (s[i+1] == '0' || s[i+1] == '1')) ch = s[++i] == '0' ? '~' : '/';
+        if (j >= kn || k[j] != ch) return 0;
+    }
+    return j == kn;
+}
+
+size_t cinta_puntero(const Cinta *c, const char *p, size_t n, size_t *clave){
+    size_t i = 0, k = CINTA_NADA;
+    if (!c->n) return CINTA_NADA;
+    if (n && p[0] != '/') return CINTA_NADA;
+    while (n){
+        const char *s = p + 1;
+        const char *fin = (const char*)memchr(s, '/', n - 1);
+        size_t sn = fin ? (size_t)(fin - s) : n - 1;
+        p = s + sn; n -= sn + 1;
+
+        char tipo = cinta_tipo(c, i);
+        if (tipo == '{'){
+            size_t j = i + 1;
+            for (;;){
+                if (cinta_tipo(c, j) == '}') return CINTA_NADA;
+                size_t kn;
+                const char *kt = cinta_texto(c, j, &kn);
+                if (segmento_igual(s, sn, kt, kn)) break;
+                j = cinta_siguiente(c, j + 1);
+            }
+            k = j; i = j + 1;
+        } else if (tipo == '['){
+            /* indice: 0 o [1-9][0-9]* ("-" no existe al leer) */
+            size_t idx = 0;
+            if (!sn || (s[0] == '0' && sn > 1)) return CINTA_NADA;
+            for (size_t m = 0; m < sn; m++){
+                if ((unsigned)(s[m] - '0') > 9) return CINTA_NADA;
+                idx = idx * 10 + (size_t)(s[m] - '0');
+            }
+            size_t j = i + 1;
+            for (; idx; idx--){
+                if (cinta_tipo(c, j) == ']') return CINTA_NADA;
+                j = cinta_siguiente(c, j);
+            }
+            if (cinta_tipo(c, j) == ']') return CINTA_NADA;
+            k = CINTA_NADA; i = j;
+        } else return CINTA_NADA;
+    }
+    if (clave) *clave = k;
+    return i;
+}
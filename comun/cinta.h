@@ -0,0 +1,83 @@
+/* cinta.h - Documento JSON en una "cinta" plana con acceso por JSON Pointer
+ *
+ * Un arreglo contiguo de entradas de 64 bits, una por valor en el orden
+ * del texto: los 8 bits altos dicen el tipo y los 56 bajos el dato. Cada
+ * '{' / '[' guarda la posicion de su cierre (y el cierre la de su
+ * apertura), asi un subarbol entero se saltea en O(1). Las cadenas y los
+ * lexemas de los numeros van a un bufer aparte.
+ *
+ *   '{' '['   dato = indice del '}' / ']' que la cierra
+ *   '}' ']'   dato = indice de la apertura
+ *   '"'       dato = desplazamiento en cad: largo (uint32_t), bytes, '\0'
+ *   'l' 'd'   numero entero / real: dato = lexema en cad como una cadena,
+ *             y la entrada siguiente es el valor crudo (int64_t o double)
+ *   't' 'f' 'n'   true, false, null
+ *
+ * En un objeto cada miembro es la cadena de la clave seguida del valor.
+ */
+#ifndef CINTA_H
+#define CINTA_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+#include "numero.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CINTA_NADA ((size_t)-1)
+
+typedef struct {
+    uint64_t *t; size_t n, cap;       /* entradas */
+    char *cad; size_t cad_n, cad_cap; /* cadenas y lexemas */
+    size_t *abiertos;                 /* aperturas sin cerrar (al construir) */
+    size_t prof, prof_cap;
+} Cinta;
+
+void cinta_init(Cinta *c);
+void cinta_free(Cinta *c);
+/* vacia la cinta conservando la memoria (siguiente documento) */
+void cinta_vaciar(Cinta *c);
+
+/* Construccion en orden de texto; el parser garantiza la gramatica. */
+void cinta_abrir(Cinta *c, char tipo);            /* '{' o '[' */
+void cinta_cerrar(Cinta *c);                      /* cierra la ultima apertura */
+void cinta_cadena(Cinta *c, const char *s, size_t n);
+void cinta_numero(Cinta *c, const char *lex, size_t n, const Numero *v);
+void cinta_literal(Cinta *c, char tipo);          /* 't', 'f' o 'n' */
+/* tipo de la apertura mas interna ('{' o '['), 0 si no hay */
+char cinta_abierto(const Cinta *c);
+
+static inline char cinta_tipo(const Cinta *c, size_t i){ return (char)(c->t[i] >> 56); }
+static inline uint64_t cinta_dato(const Cinta *c, size_t i){ return c->t[i] & ((1ULL << 56) - 1); }
+
+/* Cadena (o lexema de numero) de la entrada i */
+static inline const char *cinta_texto(const Cinta *c, size_t i, size_t *n){
+    const char *p = c->cad + cinta_dato(c, i);
+    uint32_t len;
+    memcpy(&len, p, sizeof len);
+    *n = len;
+    return p + sizeof len;
+}
+
+/* Indice del valor que sigue al que empieza en i (salta subarboles) */
+static inline size_t cinta_siguiente(const Cinta *c, size_t i){
+    char k = cinta_tipo(c, i);
+    if (k == '{' || k == '[') return (size_t)cinta_dato(c, i) + 1;
+    if (k == 'l' || k == 'd') return i + 2;
+    return i + 1;
+}
+
+/* Busca el puntero p[0..n) (RFC 6901: "/personas/1/nombre", "" es la
+ * raiz, ~1 es '/' y ~0 es '~'). Devuelve el indice del valor o CINTA_NADA.
+ * Si clave no es NULL y el valor es miembro de un objeto, deja ahi el
+ * indice de su clave (si no, CINTA_NADA). */
+size_t cinta_puntero(const Cinta *c, const char *p, size_t n, size_t *clave);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
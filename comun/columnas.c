@@ -0,0 +1,453 @@
+/* columnas.c - ver columnas.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdarg.h>
+#include "columnas.h"
+#include "estadisticas.h"
+
+/* El recorrido es recursivo por niveles del documento: mas hondo que esto
+ * se descarta (la pila de C de Windows es de 1 MB) */
+#define COL_PROF_MAX 1000
+#define NINGUNA ((size_t)-1)
+
+typedef struct { unsigned char *p; size_t n, cap; } Bufer;
+
+static void bufer_reservar(Bufer *b, size_t n){
+    if (b->n + n <= b->cap) return;
+    size_t cap = b->cap ? b->cap : 256;
+    while (cap < b->n + n) cap *= 2;
+    EST(est_asignacion(cap));
+    b->p = (unsigned char*)realloc(b->p, cap);
+    if (!b->p){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    b->cap = cap;
+}
+static void bufer_poner(Bufer *b, const void *s, size_t n){
+    bufer_reservar(b, n);
+    if (n) memcpy(b->p + b->n, s, n);
+    b->n += n;
+}
+static void bufer_ceros(Bufer *b, size_t n){
+    bufer_reservar(b, n);
+    memset(b->p + b->n, 0, n);
+    b->n += n;
+}
+
+typedef struct {
+    char *nombre; size_t nlen;
+    int tipo;                      /* COL_* */
+    uint64_t n;                    /* filas ya puestas, con valor o null */
+    Bufer validos;                 /* un bit por fila */
+    Bufer valores;                 /* COL_CADENA: donde empieza cada una en datos */
+    Bufer datos;
+} Columna;
+
+typedef struct {
+    char *ruta; size_t rlen;
+    size_t padre;                  /* tabla padre o NINGUNA */
+    int clase;                     /* 0 sin decidir, '{' objetos, 'v' escalares */
+    int descartada;
+    uint64_t filas;                /* incluida la que se esta llenando */
+    Bufer fila_padre;
+    Columna *col; size_t ncol, col_cap;
+    size_t cursor;                 /* las claves suelen venir en el mismo orden */
+} Tabla;
+
+typedef struct {
+    const Cinta *c;
+    size_t muestra;
+    Tabla *t; size_t nt, t_cap;
+    ColError error; void *ctx;
+    size_t errores;
+    Bufer nombre;                  /* columna en armado ("dir.calle") */
+    Bufer camino;                  /* ruta en armado ("/dir/calle") */
+    Bufer ruta;                    /* de la tabla hija que se busca */
+} Col;
+
+static const char *tipo_nombre(int t){
+    static const char *n[] = { "null", "bool", "entero", "real", "cadena" };
+    return n[t];
+}
+
+/* Marca la tabla como descartada e informa por que (una sola vez) */
+static void descartar(Col *k, size_t ti, const char *fmt, ...){
+    Tabla *t = &k->t[ti];
+    char det[256], msg[512];
+    va_list ap;
+    if (t->descartada) return;
+    t->descartada = 1;
+    va_start(ap, fmt);
+    vsnprintf(det, sizeof det, fmt, ap);
+    va_end(ap);
+    snprintf(msg, sizeof msg, "tabla '%.*s', fila %llu: %s; la tabla no sale",
+             (int)t->rlen, t->ruta, (unsigned long long)(t->filas ? t->filas - 1 : 0), det);
+    k->error(k->ctx, msg);
+    k->errores++;
+}
+
+/* '~' y '/' de una clave como en JSON Pointer */
+static void escapar(Bufer *b, const char *s, size_t n){
+    for (size_t i = 0; i < n; i++){
+        if (s[i] == '~') bufer_poner(b, "~0", 2);
+        else if (s[i] == '/') bufer_poner(b, "~1", 2);
+        else bufer_poner(b, s + i, 1);
+    }
+}
+
+static size_t tabla(Col *k, const char *ruta, size_t rlen, size_t padre){
+    for (size_t i = 0; i < k->nt; i++)
+        if (k->t[i].padre == padre && k->t[i].rlen == rlen && memcmp(k->t[i].ruta, ruta, rlen) == 0)
+            return i;
+    if (k->nt == k->t_cap){
+        k->t_cap = k->t_cap ? k->t_cap * 2 : 16;
+        EST(est_asignacion(k->t_cap * sizeof *k->t));
+        k->t = (Tabla*)realloc(k->t, k->t_cap * sizeof *k->t);
+        if (!k->t){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    Tabla *t = &k->t[k->nt];
+    memset(t, 0, sizeof *t);
+    t->ruta = (char*)malloc(rlen + 1);
+    if (!t->ruta){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    if (rlen) memcpy(t->ruta, ruta, rlen);
+    t->rlen = rlen;
+    t->padre = padre;
+    return k->nt++;
+}
+
+/* Columna nombre[0..n) de la tabla; fuera de la muestra no se crean */
+static Columna *columna(Col *k, size_t ti, const char *nombre, size_t n){
+    Tabla *t = &k->t[ti];
+    size_t i = t->cursor < t->ncol ? t->cursor : 0;
+    for (size_t m = 0; m < t->ncol; m++, i = i + 1 == t->ncol ? 0 : i + 1){
+        Columna *c = &t->col[i];
+        if (c->nlen == n && memcmp(c->nombre, nombre, n) == 0){
+            t->cursor = i + 1;
+            return c;
+        }
+    }
+    if (t->filas > k->muestra){
+        descartar(k, ti, "la clave '%.*s' no esta en el esquema", (int)n, nombre);
+        return NULL;
+    }
+    if (t->ncol == t->col_cap){
+        t->col_cap = t->col_cap ? t->col_cap * 2 : 8;
+        EST(est_asignacion(t->col_cap * sizeof *t->col));
+        t->col = (Columna*)realloc(t->col, t->col_cap * sizeof *t->col);
+        if (!t->col){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    }
+    Columna *c = &t->col[t->ncol];
+    memset(c, 0, sizeof *c);
+    c->nombre = (char*)malloc(n + 1);
+    if (!c->nombre){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    memcpy(c->nombre, nombre, n);
+    c->nlen = n;
+    c->tipo = COL_NULO;
+    t->cursor = ++t->ncol;
+    return c;
+}
+
+/* Completa con null hasta la fila hasta (sin incluirla) */
+static void nulos(Columna *c, uint64_t hasta){
+    if (c->n >= hasta) return;
+    uint64_t m = hasta - c->n;
+    size_t bytes = (size_t)((hasta + 7) / 8);
+    if (c->validos.n < bytes) bufer_ceros(&c->validos, bytes - c->validos.n);
+    switch (c->tipo){
+        case COL_BOOL: bufer_ceros(&c->valores, (size_t)m); break;
+        case COL_ENTERO:
+        case COL_REAL: bufer_ceros(&c->valores, (size_t)m * 8); break;
+        case COL_CADENA:
+            for (uint64_t i = 0; i < m; i++){
+                uint64_t o = c->datos.n;
+                bufer_poner(&c->valores, &o, 8);
+            }
+            break;
+    }
+    c->n = hasta;
+}
+
+/* La columna pasa a recibir valores de tipo t; 0 si no puede */
+static int fijar_tipo(Col *k, size_t ti, Columna *c, int t){
+    if (c->tipo == t) return 1;
+    if (c->tipo == COL_NULO){
+        uint64_t n = c->n;
+        c->tipo = t;
+        c->n = 0;
+        nulos(c, n);
+        return 1;
+    }
+    if (c->tipo == COL_ENTERO && t == COL_REAL){
+        for (size_t i = 0; i < c->valores.n; i += 8){
+            int64_t v;
+            memcpy(&v, c->valores.p + i, 8);
+            double d = (double)v;
+            memcpy(c->valores.p + i, &d, 8);
+        }
+        c->tipo = COL_REAL;
+        return 1;
+    }
+    if (c->tipo == COL_REAL && t == COL_ENTERO) return 1;   /* se guarda como real */
+    descartar(k, ti, "la columna '%.*s' es %s y llega un valor %s",
+              (int)c->nlen, c->nombre, tipo_nombre(c->tipo), tipo_nombre(t));
+    return 0;
+}
+
+/* El escalar de la entrada i en la fila actual de la tabla */
+static void valor(Col *k, size_t ti, Columna *c, size_t i){
+    const Cinta *cin = k->c;
+    uint64_t fila = k->t[ti].filas - 1;
+    if (c->n > fila){
+        descartar(k, ti, "la clave '%.*s' esta repetida", (int)c->nlen, c->nombre);
+        return;
+    }
+    nulos(c, fila);
+    char t = cinta_tipo(cin, i);
+    int ct = t == '"' ? COL_CADENA : t == 'l' ? COL_ENTERO : t == 'd' ? COL_REAL
+           : t == 'n' ? COL_NULO : COL_BOOL;
+    if (ct == COL_NULO){ nulos(c, fila + 1); return; }
+    if (!fijar_tipo(k, ti, c, ct)) return;
+    if (c->validos.n < fila / 8 + 1) bufer_ceros(&c->validos, fila / 8 + 1 - c->validos.n);
+    c->validos.p[fila / 8] |= (unsigned char)(1u << (fila % 8));
+    switch (c->tipo){
+        case COL_BOOL: {
+            unsigned char b = t == 't';
+            bufer_poner(&c->valores, &b, 1);
+            break;
+        }
+        case COL_ENTERO:
+            bufer_poner(&c->valores, &cin->t[i + 1], 8);
+            break;
+        case COL_REAL: {
+            double d;
+            if (t == 'l'){
+                int64_t v;
+                memcpy(&v, &cin->t[i + 1], 8);
+                d = (double)v;
+            } else memcpy(&d, &cin->t[i + 1], 8);
+            bufer_poner(&c->valores, &d, 8);
+            break;
+        }
+        case COL_CADENA: {
+            size_t n;
+            const char *s = cinta_texto(cin, i, &n);
+            uint64_t o = c->datos.n;
+            bufer_poner(&c->valores, &o, 8);
+            bufer_poner(&c->datos, s, n);
+            break;
+        }
+    }
+    c->n = fila + 1;
+}
+
+static void fila_array(Col *k, size_t ti, size_t i, size_t prof, size_t bn, size_t bc);
+
+/* Miembros del objeto i en la fila actual de la tabla. Los nombres de
+ * columna y el camino de esta fila empiezan en bn y bc de k->nombre y
+ * k->camino (lo anterior es de las filas que la contienen). */
+static void fila_objeto(Col *k, size_t ti, size_t i, size_t prof, size_t bn, size_t bc){
+    const Cinta *c = k->c;
+    size_t fin = (size_t)cinta_dato(c, i);
+    size_t nn = k->nombre.n, nc = k->camino.n;
+    if (prof > COL_PROF_MAX){
+        descartar(k, ti, "demasiado anidada (mas de %d niveles)", COL_PROF_MAX);
+        return;
+    }
+    for (size_t j = i + 1; j < fin && !k->t[ti].descartada; ){
+        size_t n, v = j + 1;
+        const char *s = cinta_texto(c, j, &n);
+        k->nombre.n = nn; k->camino.n = nc;
+        if (nn > bn) bufer_poner(&k->nombre, ".", 1);
+        bufer_poner(&k->nombre, s, n);
+        bufer_poner(&k->camino, "/", 1);
+        escapar(&k->camino, s, n);
+        char tv = cinta_tipo(c, v);
+        if (tv == '{') fila_objeto(k, ti, v, prof + 1, bn, bc);
+        else if (tv == '[') fila_array(k, ti, v, prof + 1, bn, bc);
+        else {
+            Columna *col = columna(k, ti, (const char*)k->nombre.p + bn, k->nombre.n - bn);
+            if (col) valor(k, ti, col, v);
+        }
+        j = cinta_siguiente(c, v);
+    }
+    k->nombre.n = nn; k->camino.n = nc;
+}
+
+/* El array i de la fila actual: sus elementos son filas de la tabla hija */
+static void fila_array(Col *k, size_t ti, size_t i, size_t prof, size_t bn, size_t bc){
+    const Cinta *c = k->c;
+    size_t fin = (size_t)cinta_dato(c, i);
+    size_t nn = k->nombre.n, nc = k->camino.n;
+    k->ruta.n = 0;
+    bufer_poner(&k->ruta, k->t[ti].ruta, k->t[ti].rlen);
+    bufer_poner(&k->ruta, "/*", 2);
+    bufer_poner(&k->ruta, k->camino.p + bc, nc - bc);
+    size_t nt = k->nt;
+    size_t hi = tabla(k, (const char*)k->ruta.p, k->ruta.n, ti);
+    if (hi >= nt && k->t[ti].filas > k->muestra){
+        k->t[hi].descartada = 1;
+        descartar(k, ti, "el array '%.*s' no esta en el esquema", (int)(nn - bn), (const char*)k->nombre.p + bn);
+        return;
+    }
+    uint64_t fila_padre = k->t[ti].filas - 1;
+    for (size_t e = i + 1; e < fin && !k->t[hi].descartada; e = cinta_siguiente(c, e)){
+        char te = cinta_tipo(c, e);
+        int clase = te == '{' || te == '[' ? te : 'v';
+        Tabla *h = &k->t[hi];
+        if (clase == '['){
+            h->filas++;
+            descartar(k, hi, "un array de arrays no es una tabla");
+            break;
+        }
+        if (!h->clase) h->clase = clase;
+        else if (h->clase != clase){
+            h->filas++;
+            descartar(k, hi, clase == 'v' ? "un valor entre objetos" : "un objeto entre valores");
+            break;
+        }
+        h->filas++;
+        bufer_poner(&h->fila_padre, &fila_padre, 8);
+        if (clase == '{') fila_objeto(k, hi, e, prof + 1, nn, nc);
+        else {
+            Columna *col = columna(k, hi, "value", 5);
+            if (col) valor(k, hi, col, e);
+        }
+    }
+    k->nombre.n = nn; k->camino.n = nc;
+}
+
+/* Fuera de las tablas: el primer array de objetos de cada rama es una tabla */
+static void buscar(Col *k, size_t i, size_t prof){
+    const Cinta *c = k->c;
+    char t = cinta_tipo(c, i);
+    if (t != '{' && t != '[') return;
+    size_t fin = (size_t)cinta_dato(c, i), nc = k->camino.n;
+    if (prof > COL_PROF_MAX){
+        k->error(k->ctx, "documento demasiado anidado para buscar tablas");
+        k->errores++;
+        return;
+    }
+    if (t == '['){
+        int objetos = fin > i + 1;
+        for (size_t e = i + 1; e < fin && objetos; e = cinta_siguiente(c, e))
+            objetos = cinta_tipo(c, e) == '{';
+        if (objetos){
+            size_t ti = tabla(k, (const char*)k->camino.p, nc, NINGUNA);
+            k->t[ti].clase = '{';
+            for (size_t e = i + 1; e < fin && !k->t[ti].descartada; e = cinta_siguiente(c, e)){
+                k->t[ti].filas++;
+                fila_objeto(k, ti, e, prof + 1, k->nombre.n, nc);
+            }
+            return;
+        }
+        for (size_t e = i + 1; e < fin; e = cinta_siguiente(c, e)){
+            k->camino.n = nc;
+            bufer_poner(&k->camino, "/*", 2);
+            buscar(k, e, prof + 1);
+        }
+    } else {
+        for (size_t j = i + 1; j < fin; j = cinta_siguiente(c, j + 1)){
+            size_t n;
+            const char *s = cinta_texto(c, j, &n);
+            k->camino.n = nc;
+            bufer_poner(&k->camino, "/", 1);
+            escapar(&k->camino, s, n);
+            buscar(k, j + 1, prof + 1);
+        }
+    }
+    k->camino.n = nc;
+}
+
+static void relleno(Col *k, ColEscribir escribir, uint64_t n){
+    static const char ceros[8];
+    if (n % 8) escribir(k->ctx, ceros, (size_t)(8 - n % 8));
+}
+
+static void escribir_tabla(Col *k, ColEscribir escribir, Tabla *t, uint32_t padre){
+    ColTabla ct;
+    memset(&ct, 0, sizeof ct);
+    ct.filas = t->filas;
+    ct.padre = padre;
+    ct.ncolumnas = (uint32_t)t->ncol;
+    ct.largo_ruta = (uint32_t)t->rlen;
+    escribir(k->ctx, &ct, sizeof ct);
+    escribir(k->ctx, t->ruta, t->rlen);
+    relleno(k, escribir, t->rlen);
+    if (padre != COL_NINGUNA) escribir(k->ctx, t->fila_padre.p, (size_t)t->filas * 8);
+    for (size_t j = 0; j < t->ncol; j++){
+        Columna *c = &t->col[j];
+        ColColumna cc;
+        memset(&cc, 0, sizeof cc);
+        nulos(c, t->filas);
+        cc.largo_nombre = (uint32_t)c->nlen;
+        cc.tipo = (uint8_t)c->tipo;
+        escribir(k->ctx, &cc, sizeof cc);
+        escribir(k->ctx, c->nombre, c->nlen);
+        relleno(k, escribir, c->nlen);
+        escribir(k->ctx, c->validos.p, c->validos.n);
+        relleno(k, escribir, c->validos.n);   /* (filas+63)/64 palabras */
+        switch (c->tipo){
+            case COL_BOOL:
+                escribir(k->ctx, c->valores.p, c->valores.n);
+                relleno(k, escribir, c->valores.n);
+                break;
+            case COL_ENTERO:
+            case COL_REAL:
+                escribir(k->ctx, c->valores.p, c->valores.n);
+                break;
+            case COL_CADENA: {
+                uint64_t fin = c->datos.n;
+                escribir(k->ctx, c->valores.p, c->valores.n);
+                escribir(k->ctx, &fin, 8);
+                escribir(k->ctx, c->datos.p, c->datos.n);
+                relleno(k, escribir, c->datos.n);
+                break;
+            }
+        }
+    }
+}
+
+size_t col_traducir(const Cinta *c, size_t muestra, ColEscribir escribir,
+                    ColError error, void *ctx){
+    Col k;
+    memset(&k, 0, sizeof k);
+    k.c = c;
+    k.muestra = muestra ? muestra : 1;
+    k.error = error; k.ctx = ctx;
+    if (c->n) buscar(&k, 0, 0);
+
+    /* las hijas de una tabla descartada tampoco salen; las demas se
+     * numeran en orden (los padres ya estan antes) */
+    uint32_t *num = (uint32_t*)malloc((k.nt ? k.nt : 1) * sizeof *num);
+    if (!num){ fprintf(stderr, "Out of memory\n"); exit(1); }
+    uint32_t salen = 0;
+    for (size_t i = 0; i < k.nt; i++){
+        Tabla *t = &k.t[i];
+        if (!t->descartada && t->padre != NINGUNA && k.t[t->padre].descartada){
+            char msg[512];
+            t->descartada = 1;
+            snprintf(msg, sizeof msg, "tabla '%.*s': su tabla padre no sale", (int)t->rlen, t->ruta);
+            error(ctx, msg);
+            k.errores++;
+        }
+        num[i] = t->descartada ? COL_NINGUNA : salen++;
+    }
+    ColCabecera cab;
+    memset(&cab, 0, sizeof cab);
+    memcpy(cab.magia, COL_MAGIA, 4);
+    cab.version = COL_VERSION;
+    cab.ntablas = salen;
+    escribir(ctx, &cab, sizeof cab);
+    for (size_t i = 0; i < k.nt; i++){
+        Tabla *t = &k.t[i];
+        if (num[i] != COL_NINGUNA)
+            escribir_tabla(&k, escribir, t, t->padre == NINGUNA ? COL_NINGUNA : num[t->padre]);
+        for (size_t j = 0; j < t->ncol; j++){
+            free(t->col[j].nombre);
+            free(t->col[j].validos.p); free(t->col[j].valores.p); free(t->col[j].datos.p);
+        }
+        free(t->col); free(t->ruta); free(t->fila_padre.p);
+    }
+    free(num); free(k.t);
+    free(k.nombre.p); free(k.camino.p); free(k.ruta.p);
+    return k.errores;
+}
@@ -0,0 +1,86 @@
+/* columnas.h - Tablas de un documento en formato por columnas
+ *
+ * Una tabla es un array de objetos: cada objeto es una fila y cada clave
+ * una columna. El esquema (columnas y tipos) sale de las primeras
+ * `muestra` filas de la tabla y las siguientes tienen que seguirlo: una
+ * clave nueva o un valor de otro tipo descartan la tabla (con un mensaje).
+ * Un entero en una columna real se convierte y una columna entera que
+ * recibe un real pasa a ser real; una columna que solo tuvo null toma el
+ * tipo del primer valor que llegue.
+ *
+ * Dentro de una fila un objeto se aplana (columna "dir.calle") y un
+ * array es una tabla hija, con una fila por elemento y la fila del padre
+ * al frente: asi /personas/<i>/hijos queda en una sola tabla que se une
+ * con /personas por numero de fila. Un array de escalares en una fila es
+ * una tabla hija con la columna "value". Fuera de las filas solo se
+ * buscan tablas; lo demas del documento no sale.
+ *
+ * Archivo (enteros en el orden de bytes de la maquina; cada bloque
+ * empieza en un multiplo de 8 para usarlo tal cual desde un mapeo):
+ *
+ *   ColCabecera
+ *   por tabla (los padres antes que sus hijas):
+ *     ColTabla, ruta (relleno a 8)
+ *     si padre != COL_NINGUNA: fila del padre, filas x uint64
+ *     por columna:
+ *       ColColumna, nombre (relleno a 8)
+ *       validos: bit i en 1 si la fila i no es null, (filas+63)/64 x uint64
+ *       COL_ENTERO, COL_REAL: filas x int64 / double
+ *       COL_BOOL: filas bytes (relleno a 8)
+ *       COL_CADENA: filas+1 desplazamientos uint64 y los bytes (relleno a 8)
+ *       COL_NULO: nada mas (solo hubo null)
+ *
+ * La ruta de una tabla es la del array como JSON Pointer con '*' en
+ * lugar de cada indice de fila, como en --select.
+ */
+#ifndef COLUMNAS_H
+#define COLUMNAS_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include "cinta.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define COL_MAGIA "JCOL"
+#define COL_VERSION 1
+#define COL_NINGUNA UINT32_MAX
+
+enum { COL_NULO, COL_BOOL, COL_ENTERO, COL_REAL, COL_CADENA };
+
+typedef struct {
+    char magia[4];
+    uint32_t version;
+    uint32_t ntablas;
+    uint32_t reservado;
+} ColCabecera;
+
+typedef struct {
+    uint64_t filas;
+    uint32_t padre;          /* tabla padre (indice en el archivo) o COL_NINGUNA */
+    uint32_t ncolumnas;
+    uint32_t largo_ruta;
+    uint32_t reservado;
+} ColTabla;
+
+typedef struct {
+    uint32_t largo_nombre;
+    uint8_t tipo;            /* COL_* */
+    uint8_t reservado[3];
+} ColColumna;
+
+typedef void (*ColEscribir)(void *ctx, const void *s, size_t n);
+typedef void (*ColError)(void *ctx, const char *msg);
+
+/* Escribe las tablas del documento de la cinta c con escribir. Cada
+ * tabla descartada se informa con error. Devuelve cuantas se descartaron. */
+size_t col_traducir(const Cinta *c, size_t muestra, ColEscribir escribir,
+                    ColError error, void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
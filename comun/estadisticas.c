@@ -0,0 +1,151 @@
+/* estadisticas.c - ver estadisticas.h */
+
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700
+#endif
+#include <string.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <signal.h>
+#include <sys/time.h>
+#endif
+#include "estadisticas.h"
+
+Estadisticas est;
+
+#define MUESTREO_US 1000
+
+static double reloj_pared(void){
+#ifdef _WIN32
+    LARGE_INTEGER f, c;
+    QueryPerformanceFrequency(&f);
+    QueryPerformanceCounter(&c);
+    return (double)c.QuadPart / (double)f.QuadPart;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_MONOTONIC, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
+
+static double reloj_cpu(void){
+#ifdef _WIN32
+    FILETIME c, s, k, u;
+    GetProcessTimes(GetCurrentProcess(), &c, &s, &k, &u);
+    return ((double)(((unsigned long long)k.dwHighDateTime << 32) | k.dwLowDateTime) +
+            (double)(((unsigned long long)u.dwHighDateTime << 32) | u.dwLowDateTime)) * 1e-7;
+#else
+    struct timespec t;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &t);
+    return (double)t.tv_sec + (double)t.tv_nsec * 1e-9;
+#endif
+}
+
+#ifdef _WIN32
+/* Sin SIGPROF: un hilo muestrea la pared y el CPU se reparte igual */
+static volatile LONG muestreando;
+static HANDLE hilo;
+static DWORD WINAPI hilo_muestreo(LPVOID x){
+    (void)x;
+    while (muestreando){
+        Sleep(1);
+        est.muestras_pared[est.fase]++;
+    }
+    return 0;
+}
+static void muestreo(int activar){
+    if (activar){
+        muestreando = 1;
+        hilo = CreateThread(NULL, 0, hilo_muestreo, NULL, 0, NULL);
+    } else if (hilo){
+        muestreando = 0;
+        WaitForSingleObject(hilo, INFINITE);
+        CloseHandle(hilo);
+        hilo = NULL;
+        for (int i = 0; i < EST_FASES; i++) est.muestras_cpu[i] = est.muestras_pared[i];
+    }
+}
+#else
+static void muestra_cpu(int s){ (void)s; est.muestras_cpu[est.fase]++; }
+static void muestra_pared(int s){ (void)s; est.muestras_pared[est.fase]++; }
+/* SA_RESTART: fgets/fread no se enteran; read/write ya reintentan EINTR */
+static void muestreo(int activar){
+    struct itimerval t;
+    memset(&t, 0, sizeof t);
+    if (activar){
+        struct sigaction sa;
+        memset(&sa, 0, sizeof sa);
+        sa.sa_flags = SA_RESTART;
+        sa.sa_handler = muestra_cpu;
+        sigaction(SIGPROF, &sa, NULL);
+        sa.sa_handler = muestra_pared;
+        sigaction(SIGALRM, &sa, NULL);
+        t.it_interval.tv_usec = t.it_value.tv_usec = MUESTREO_US;
+    }
+    setitimer(ITIMER_PROF, &t, NULL);
+    setitimer(ITIMER_REAL, &t, NULL);
+}
+#endif
+
+void est_iniciar(const char *herramienta, const char *entrada, EstFase f){
+    memset(&est, 0, sizeof est);
+    est.activo = 1;
+    est.herramienta = herramienta;
+    est.entrada = entrada;
+    est.fase = est.previa = f;
+    est.inicio = reloj_pared();
+    est.inicio_cpu = reloj_cpu();
+    muestreo(1);
+}
+
+static void json_texto(FILE *f, const char *s){
+    fputc('"', f);
+    for (; *s; s++){
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') fprintf(f, "\\%c", c);
+        else if (c < 0x20) fprintf(f, "\\u%04x", c);
+        else fputc(c, f);
+    }
+    fputc('"', f);
+}
+
+void est_reportar(FILE *f){
+    static const char *fases[EST_FASES] = { "leer", "lexico", "sintaxis", "salida" };
+    static const char *tipos[LX_ERROR + 1] = {
+        "LLAVE_A", "LLAVE_C", "CORCHETE_A", "CORCHETE_C", "COMA", "DOS_PUNTOS",
+        "CADENA", "NUMERO", "TRUE", "FALSE", "NULL", "FIN", "ERROR"
+    };
+    if (!est.activo) return;
+    muestreo(0);
+    est.activo = 0;
+    double pared = reloj_pared() - est.inicio, cpu = reloj_cpu() - est.inicio_cpu;
+    unsigned long mp = 0, mc = 0;
+    unsigned long long tokens = 0;
+    for (int i = 0; i < EST_FASES; i++){ mp += est.muestras_pared[i]; mc += est.muestras_cpu[i]; }
+    for (int i = 0; i <= LX_ERROR; i++) tokens += est.tokens[i];
+
+    fprintf(f, "{\"herramienta\":");
+    json_texto(f, est.herramienta);
+    fprintf(f, ",\"entrada\":");
+    json_texto(f, est.entrada);
+    fprintf(f, ",\"pared\":%.6f,\"cpu\":%.6f,\"muestras\":%lu,\"fases\":{", pared, cpu, mp);
+    for (int i = 0; i < EST_FASES; i++)
+        fprintf(f, "%s\"%s\":{\"pared\":%.6f,\"cpu\":%.6f}", i ? "," : "", fases[i],
+                mp ? pared * (double)est.muestras_pared[i] / (double)mp : 0.0,
+                mc ? cpu * (double)est.muestras_cpu[i] / (double)mc : 0.0);
+    fprintf(f, "},\"bytes_entrada\":%llu,\"bytes_salida\":%llu,\"tokens\":%llu",
+            est.bytes_entrada, est.bytes_salida, tokens);
+    fprintf(f, ",\"mb_por_seg\":%.2f,\"tokens_por_seg\":%.0f",
+            pared > 0 ? (double)est.bytes_entrada / pared / 1e6 : 0.0,
+            pared > 0 ? (double)tokens / pared : 0.0);
+    fprintf(f, ",\"tokens_por_tipo\":{");
+    for (int i = 0, primero = 1; i <= LX_ERROR; i++){
+        if (i == LX_FIN) continue;
+        fprintf(f, "%s\"%s\":%llu", primero ? "" : ",", tipos[i], est.tokens[i]);
+        primero = 0;
+    }
+    fprintf(f, "},\"profundidad_max\":%zu,\"asignaciones\":%llu,\"bytes_asignados\":%llu}\n",
+            est.profundidad_max, est.asignaciones, est.bytes_asignados);
+}
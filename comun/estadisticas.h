@@ -0,0 +1,78 @@
+/* estadisticas.h - Contadores de --stats comunes a las tres herramientas
+ *
+ * Con --stats cada herramienta mide el tiempo de pared y de CPU de sus
+ * fases (leer, lexico, sintaxis, salida), cuenta bytes, tokens por tipo,
+ * la profundidad maxima y las asignaciones, y al terminar escribe todo
+ * como una linea JSON en stderr.
+ *
+ * Las fases se intercalan token a token, asi que no se lee un reloj en
+ * cada cambio: la herramienta solo anota la fase en curso (est.fase) y un
+ * temporizador la muestrea cada milisegundo, de CPU (SIGPROF) y de pared
+ * (SIGALRM; en Windows un hilo). Los totales son exactos; el reparto entre
+ * fases sale de las muestras.
+ *
+ * Sin --stats no se mide nada: lo que esta en los caminos calientes va
+ * dentro de EST(...), que es un if sobre est.activo. Compilando con
+ * -DSIN_STATS, EST(...) no genera codigo y --stats solo avisa que no esta.
+ */
+#ifndef ESTADISTICAS_H
+#define ESTADISTICAS_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include "lexico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { EST_LEER, EST_LEXICO, EST_SINTAXIS, EST_SALIDA, EST_FASES } EstFase;
+
+typedef struct {
+    int activo;
+    const char *herramienta, *entrada;
+    volatile int fase;                   /* EstFase en curso (la lee el muestreo) */
+    int previa;                          /* la de antes de est_entrar */
+    volatile unsigned long muestras_pared[EST_FASES], muestras_cpu[EST_FASES];
+    double inicio, inicio_cpu;
+    unsigned long long tokens[LX_ERROR + 1];   /* por LxTipo (sin LX_FIN) */
+    unsigned long long bytes_entrada, bytes_salida;
+    unsigned long long asignaciones, bytes_asignados;
+    size_t profundidad_max;
+} Estadisticas;
+
+extern Estadisticas est;
+
+#ifdef SIN_STATS
+#define EST(...) ((void)0)
+#define EST_DISPONIBLE 0
+#else
+#define EST(...) do { if (est.activo) { __VA_ARGS__; } } while (0)
+#define EST_DISPONIBLE 1
+#endif
+
+/* Activa la medicion empezando en la fase f */
+void est_iniciar(const char *herramienta, const char *entrada, EstFase f);
+static inline void est_fase(EstFase f){ est.fase = f; }
+/* Entra a la fase f por un rato (una lectura, un token) y vuelve */
+static inline void est_entrar(EstFase f){ est.previa = est.fase; est.fase = f; }
+static inline void est_volver(void){ est.fase = est.previa; }
+/* Cuenta el token t (LX_FIN y los valores fuera de rango no cuentan) */
+static inline void est_token(int t){
+    if (t >= 0 && t <= LX_ERROR && t != LX_FIN) est.tokens[t]++;
+}
+static inline void est_profundidad(size_t d){
+    if (d > est.profundidad_max) est.profundidad_max = d;
+}
+static inline void est_asignacion(size_t n){
+    est.asignaciones++;
+    est.bytes_asignados += n;
+}
+/* Detiene el muestreo y escribe el reporte JSON (una linea) */
+void est_reportar(FILE *f);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,223 @@
+/* flujo.c - ver flujo.h */
+
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#endif
+#include "flujo.h"
+
+/*--- Escritura ---*/
+static size_t poner_varint(unsigned char *s, uint64_t v){
+    size_t n = 0;
+    while (v >= 0x80){ s[n++] = (unsigned char)(v | 0x80); v >>= 7; }
+    s[n++] = (unsigned char)v;
+    return n;
+}
+
+int flujo_crear(FlujoEscritor *w, const char *ruta, int banderas){
+    memset(w, 0, sizeof *w);
+    w->f = fopen(ruta, "wb");
+    if (!w->f) return 0;
+    memcpy(w->cab.magia, FLUJO_MAGIA, 4);
+    w->cab.version = FLUJO_VERSION;
+    w->cab.banderas = (uint8_t)banderas;
+    /* la cabecera definitiva se escribe al terminar */
+    if (fwrite(&w->cab, sizeof w->cab, 1, w->f) != 1) w->err = 1;
+    return 1;
+}
+
+void flujo_escribir(FlujoEscritor *w, int tipo, uint64_t inicio, uint64_t largo,
+                    const char *lex, size_t nlex){
+    unsigned char r[30];
+    size_t n = poner_varint(r, (uint64_t)tipo);
+    n += poner_varint(r + n, inicio >= w->fin ? inicio - w->fin : 0);
+    n += poner_varint(r + n, largo);
+    if (fwrite(r, 1, n, w->f) != n) w->err = 1;
+    w->cab.ntokens++;
+    w->cab.bytes_registros += n;
+    w->fin = inicio + largo;
+    if (!(w->cab.banderas & FLUJO_TABLA) || !flujo_con_lexema(tipo)) return;
+    if (w->tabla_n + nlex + 10 > w->tabla_cap){
+        size_t cap = w->tabla_cap ? w->tabla_cap : 1 << 16;
+        while (cap < w->tabla_n + nlex + 10) cap *= 2;
+        unsigned char *t = (unsigned char*)realloc(w->tabla, cap);
+        if (!t){ w->err = 1; return; }
+        w->tabla = t; w->tabla_cap = cap;
+    }
+    w->tabla_n += poner_varint(w->tabla + w->tabla_n, nlex);
+    memcpy(w->tabla + w->tabla_n, lex, nlex);
+    w->tabla_n += nlex;
+}
+
+int flujo_terminar(FlujoEscritor *w, uint64_t largo_fuente, uint64_t huella_fuente){
+    w->cab.largo_fuente = largo_fuente;
+    w->cab.huella_fuente = huella_fuente;
+    if (w->tabla_n && fwrite(w->tabla, 1, w->tabla_n, w->f) != w->tabla_n) w->err = 1;
+    if (fseek(w->f, 0, SEEK_SET) != 0 || fwrite(&w->cab, sizeof w->cab, 1, w->f) != 1) w->err = 1;
+    if (fclose(w->f) != 0) w->err = 1;
+    free(w->tabla);
+    w->f = NULL; w->tabla = NULL;
+    return !w->err;
+}
+
+/*--- Huella ---*/
+static uint64_t mezclar(uint64_t h, uint64_t w){
+    h = (h ^ w) * 0x9E3779B97F4A7C15ULL;
+    return h ^ (h >> 29);
+}
+
+void flujo_huella_iniciar(FlujoHuella *hu){
+    memset(hu, 0, sizeof *hu);
+}
+
+void flujo_huella_sumar(FlujoHuella *hu, const void *datos, size_t n){
+    const unsigned char *s = (const unsigned char*)datos;
+    size_t r = (size_t)(hu->largo % 8);
+    uint64_t w;
+    hu->largo += n;
+    if (r){
+        size_t k = 8 - r < n ? 8 - r : n;
+        memcpy(hu->resto + r, s, k);
+        s += k; n -= k;
+        if (r + k < 8) return;
+        memcpy(&w, hu->resto, 8);
+        hu->h = mezclar(hu->h, w);
+    }
+    for (; n >= 8; s += 8, n -= 8){
+        memcpy(&w, s, 8);
+        hu->h = mezclar(hu->h, w);
+    }
+    memcpy(hu->resto, s, n);
+}
+
+uint64_t flujo_huella_fin(const FlujoHuella *hu){
+    uint64_t w = 0;
+    memcpy(&w, hu->resto, (size_t)(hu->largo % 8));
+    return mezclar(mezclar(hu->h, w), hu->largo);
+}
+
+/*--- Lectura ---*/
+/* Varint de [*p, fin); 0 si esta cortado o no entra en 64 bits */
+static int sacar_varint(const unsigned char **p, const unsigned char *fin, uint64_t *v){
+    uint64_t x = 0;
+    for (unsigned sh = 0; *p < fin && sh < 64; sh += 7){
+        unsigned char b = *(*p)++;
+        x |= (uint64_t)(b & 0x7f) << sh;
+        if (!(b & 0x80)){ *v = x; return 1; }
+    }
+    return 0;
+}
+
+/* Mapea ruta entera para leerla de corrido. 0 si no existe o esta vacia */
+static int mapear(const char *ruta, void **mapa, size_t *largo){
+#ifdef _WIN32
+    HANDLE f = CreateFileA(ruta, GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING,
+                           FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (f == INVALID_HANDLE_VALUE) return 0;
+    LARGE_INTEGER t;
+    HANDLE m = NULL;
+    if (GetFileSizeEx(f, &t) && t.QuadPart > 0)
+        m = CreateFileMappingA(f, NULL, PAGE_READONLY, 0, 0, NULL);
+    CloseHandle(f);
+    if (!m) return 0;
+    *mapa = MapViewOfFile(m, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(m);
+    if (!*mapa) return 0;
+    *largo = (size_t)t.QuadPart;
+#else
+    int fd = open(ruta, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    void *m = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+        m = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (m == MAP_FAILED) return 0;
+#ifdef MADV_SEQUENTIAL
+    madvise(m, (size_t)st.st_size, MADV_SEQUENTIAL);
+#endif
+    *mapa = m;
+    *largo = (size_t)st.st_size;
+#endif
+    return 1;
+}
+
+static void desmapear(void *mapa, size_t largo){
+#ifdef _WIN32
+    (void)largo;
+    UnmapViewOfFile(mapa);
+#else
+    munmap(mapa, largo);
+#endif
+}
+
+void flujo_cerrar(FlujoLector *r){
+    if (r->mapa) desmapear(r->mapa, r->largo);
+    r->mapa = NULL; r->datos = NULL;
+}
+
+int flujo_abrir(FlujoLector *r, const char *ruta){
+    memset(r, 0, sizeof *r);
+    if (!mapear(ruta, &r->mapa, &r->largo)) return 0;
+    r->datos = (const unsigned char*)r->mapa;
+    if (r->largo < sizeof r->cab){ flujo_cerrar(r); return 0; }
+    memcpy(&r->cab, r->datos, sizeof r->cab);
+    if (memcmp(r->cab.magia, FLUJO_MAGIA, 4) != 0 || r->cab.version != FLUJO_VERSION ||
+        r->cab.bytes_registros > r->largo - sizeof r->cab){
+        flujo_cerrar(r);
+        return 0;
+    }
+    r->p = r->datos + sizeof r->cab;
+    r->fin = r->p + r->cab.bytes_registros;
+    if (r->cab.banderas & FLUJO_TABLA){ r->t = r->fin; r->tfin = r->datos + r->largo; }
+    return 1;
+}
+
+int flujo_vigente(const FlujoLector *r, const char *fuente){
+    struct stat st;
+    if (stat(fuente, &st) != 0 || (uint64_t)st.st_size != r->cab.largo_fuente) return 0;
+    FlujoHuella hu;
+    flujo_huella_iniciar(&hu);
+    void *mapa;
+    size_t largo;
+    if (st.st_size > 0){
+        if (!mapear(fuente, &mapa, &largo)) return 0;
+        flujo_huella_sumar(&hu, mapa, largo);
+        desmapear(mapa, largo);
+    }
+    return hu.largo == r->cab.largo_fuente && flujo_huella_fin(&hu) == r->cab.huella_fuente;
+}
+
+int flujo_siguiente(FlujoLector *r, FlujoToken *t){
+    uint64_t tipo, hueco, largo;
+    if (r->leidos == r->cab.ntokens) return 0;
+    if (!sacar_varint(&r->p, r->fin, &tipo) || !sacar_varint(&r->p, r->fin, &hueco) ||
+        !sacar_varint(&r->p, r->fin, &largo) || tipo > FLUJO_SALTO){
+        r->error = 1;
+        return 0;
+    }
+    t->tipo = (int)tipo;
+    t->inicio = r->pos + hueco;
+    t->largo = largo;
+    t->lex = NULL; t->nlex = 0;
+    r->pos = t->inicio + largo;
+    r->leidos++;
+    if (r->t && flujo_con_lexema(t->tipo)){
+        uint64_t n;
+        if (!sacar_varint(&r->t, r->tfin, &n) || n > (uint64_t)(r->tfin - r->t)){
+            r->error = 1;
+            return 0;
+        }
+        t->lex = (const char*)r->t;
+        t->nlex = (size_t)n;
+        r->t += n;
+    }
+    return 1;
+}
@@ -0,0 +1,117 @@
+/* flujo.h - Archivo binario de tokens
+ *
+ * La salida del lexer en un formato que otra etapa lee sin volver a
+ * analizar el texto. Una cabecera fija y despues un registro por token
+ * (tambien los saltos de linea, asi el lector sabe la linea de cada uno),
+ * tres varints LEB128:
+ *
+ *   tipo     LxTipo, o FLUJO_SALTO para '\n'
+ *   hueco    bytes de la fuente entre el final del token anterior y este
+ *   largo    bytes del token en la fuente (las cadenas con sus comillas)
+ *
+ * Con FLUJO_TABLA, despues de los registros va la tabla de lexemas: para
+ * cada cadena, numero, palabra clave o error, en orden, un varint con el
+ * largo y los bytes del lexema tal como lo devolvio el lexer.
+ *
+ * La cabecera guarda el largo y una huella del contenido de la fuente
+ * (no la fecha, que puede no cambiar entre dos escrituras seguidas): si no
+ * coinciden el archivo de tokens esta viejo (flujo_vigente). Los enteros
+ * de la cabecera van en el orden de bytes de la maquina.
+ */
+#ifndef FLUJO_H
+#define FLUJO_H
+
+#include <stdio.h>
+#include <stddef.h>
+#include <stdint.h>
+#include "lexico.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FLUJO_MAGIA "JTOK"
+#define FLUJO_VERSION 3               /* 2: cadenas cortadas en el fin de linea (lx_cadena_linea); 3: huella */
+#define FLUJO_TABLA 1                 /* bandera: hay tabla de lexemas */
+#define FLUJO_SALTO (LX_ERROR + 1)    /* tipo del salto de linea */
+
+typedef struct {
+    char magia[4];
+    uint8_t version, banderas;
+    uint16_t reservado;
+    uint64_t ntokens;
+    uint64_t bytes_registros;
+    uint64_t largo_fuente;
+    uint64_t huella_fuente;
+} FlujoCabecera;
+
+/* Huella de la fuente, por tramos en el orden de la lectura (de cualquier
+ * largo). Mezcla de a 8 bytes: no es criptografica, alcanza para notar que
+ * la fuente cambio. */
+typedef struct {
+    uint64_t h, largo;
+    unsigned char resto[8];           /* lo que no completo 8 bytes */
+} FlujoHuella;
+
+void flujo_huella_iniciar(FlujoHuella *hu);
+void flujo_huella_sumar(FlujoHuella *hu, const void *datos, size_t n);
+uint64_t flujo_huella_fin(const FlujoHuella *hu);
+
+/* El tipo lleva lexema en la tabla */
+static inline int flujo_con_lexema(int tipo){
+    return tipo >= LX_CADENA && tipo <= LX_ERROR && tipo != LX_FIN;
+}
+
+/*--- Escritura ---*/
+typedef struct {
+    FILE *f;
+    FlujoCabecera cab;
+    uint64_t fin;                     /* final del token anterior en la fuente */
+    unsigned char *tabla;             /* la tabla se junta en memoria y va al final */
+    size_t tabla_n, tabla_cap;
+    int err;
+} FlujoEscritor;
+
+/* 0 si no se pudo crear ruta */
+int flujo_crear(FlujoEscritor *w, const char *ruta, int banderas);
+/* Un token en fuente[inicio, inicio + largo); lex[0..nlex) va a la tabla
+ * si corresponde */
+void flujo_escribir(FlujoEscritor *w, int tipo, uint64_t inicio, uint64_t largo,
+                    const char *lex, size_t nlex);
+/* Escribe la tabla y la cabecera definitiva, con la huella (flujo_huella_fin)
+ * de la fuente tal como se leyo. 0 si fallo alguna escritura */
+int flujo_terminar(FlujoEscritor *w, uint64_t largo_fuente, uint64_t huella_fuente);
+
+/*--- Lectura (el archivo se mapea entero) ---*/
+typedef struct {
+    int tipo;
+    uint64_t inicio, largo;
+    const char *lex;                  /* en la tabla (NULL sin tabla o sin lexema) */
+    size_t nlex;
+} FlujoToken;
+
+typedef struct {
+    FlujoCabecera cab;
+    const unsigned char *datos; size_t largo;
+    const unsigned char *p, *fin;     /* registros */
+    const unsigned char *t, *tfin;    /* tabla */
+    uint64_t pos;
+    uint64_t leidos;
+    int error;                        /* registro o tabla truncados */
+    void *mapa;                       /* para liberar */
+} FlujoLector;
+
+/* 0 si no existe o no es un archivo de tokens valido */
+int flujo_abrir(FlujoLector *r, const char *ruta);
+/* 1 si la fuente sigue teniendo el largo y la huella de la cabecera: la
+ * vuelve a leer entera, lo que cuesta mucho menos que analizarla */
+int flujo_vigente(const FlujoLector *r, const char *fuente);
+/* Siguiente token; 0 al final o si el archivo esta roto (r->error) */
+int flujo_siguiente(FlujoLector *r, FlujoToken *t);
+void flujo_cerrar(FlujoLector *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
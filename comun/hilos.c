@@ -0,0 +1,91 @@
+/* hilos.c - ver hilos.h */
+
+#ifndef _WIN32
+#define _XOPEN_SOURCE 700
+#endif
+#include <stdlib.h>
+#include <time.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+#include "hilos.h"
+
+struct Hilo {
+    void (*fn)(void *);
+    void *arg;
+#ifdef _WIN32
+    HANDLE h;
+#else
+    pthread_t t;
+#endif
+};
+
+#ifdef _WIN32
+static DWORD WINAPI arrancar(LPVOID x){
+    Hilo *h = (Hilo*)x;
+    h->fn(h->arg);
+    return 0;
+}
+#else
+static void *arrancar(void *x){
+    Hilo *h = (Hilo*)x;
+    h->fn(h->arg);
+    return NULL;
+}
+#endif
+
+Hilo *hilo_crear(void (*fn)(void *), void *arg){
+    Hilo *h = (Hilo*)malloc(sizeof *h);
+    if (!h) return NULL;
+    h->fn = fn; h->arg = arg;
+#ifdef _WIN32
+    h->h = CreateThread(NULL, 0, arrancar, h, 0, NULL);
+    if (!h->h){ free(h); return NULL; }
+#else
+    if (pthread_create(&h->t, NULL, arrancar, h) != 0){ free(h); return NULL; }
+#endif
+    return h;
+}
+
+void hilo_esperar(Hilo *h){
+#ifdef _WIN32
+    WaitForSingleObject(h->h, INFINITE);
+    CloseHandle(h->h);
+#else
+    pthread_join(h->t, NULL);
+#endif
+    free(h);
+}
+
+unsigned hilo_cpus(void){
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return si.dwNumberOfProcessors ? (unsigned)si.dwNumberOfProcessors : 1;
+#else
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (unsigned)n : 1;
+#endif
+}
+
+void hilo_pausa(unsigned *intentos){
+    unsigned i = (*intentos)++;
+    if (i < 64) return;
+#ifdef _WIN32
+    if (i < 128) SwitchToThread();
+    else Sleep(1);
+#else
+    if (i < 128) sched_yield();
+    else {
+        /* 50 us y creciendo hasta 1 ms: una espera larga (E/S lenta) no
+         * le quita el procesador a quien tiene que hacer el trabajo */
+        long us = 50L * (long)(i - 127);
+        struct timespec t = { 0, (us > 1000 ? 1000 : us) * 1000L };
+        nanosleep(&t, NULL);
+    }
+#endif
+}
@@ -0,0 +1,32 @@
+/* hilos.h - Hilos minimos para las herramientas
+ *
+ * Crear un hilo que corre fn(arg), esperarlo, saber cuantos procesadores
+ * hay y esperar a otro hilo sin bloquearse en el kernel. Con pthreads
+ * (compilar con -pthread) o con hilos de Win32; windows.h queda dentro de
+ * hilos.c porque winnt.h define nombres como TokenType.
+ */
+#ifndef HILOS_H
+#define HILOS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct Hilo Hilo;
+
+/* NULL si no se pudo crear */
+Hilo *hilo_crear(void (*fn)(void *), void *arg);
+/* Espera a que termine y libera el hilo */
+void hilo_esperar(Hilo *h);
+/* Procesadores en linea (al menos 1) */
+unsigned hilo_cpus(void);
+/* Una vuelta de espera activa: las primeras solo vuelven a mirar, despues
+ * cede el procesador y despues duerme, de 50 us hasta 1 ms. *intentos
+ * cuenta las vueltas de esta espera (empieza en 0). */
+void hilo_pausa(unsigned *intentos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
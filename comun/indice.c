@@ -0,0 +1,198 @@
+/* indice.c - ver indice.h */
+
+#include <stdlib.h>
+#include <string.h>
+#include "indice.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define IDX_X86 1
+#include <immintrin.h>
+#endif
+
+enum { C_EST = 1, C_COM = 2, C_BAR = 4, C_ESP = 8, C_NL = 16 };
+
+static const unsigned char clase[256] = {
+    ['['] = C_EST, [']'] = C_EST, ['{'] = C_EST, ['}'] = C_EST,
+    [','] = C_EST, [':'] = C_EST,
+    ['"'] = C_COM, ['\\'] = C_BAR,
+    [' '] = C_ESP, ['\t'] = C_ESP, ['\r'] = C_ESP, ['\n'] = C_ESP | C_NL,
+};
+
+typedef void (*ClasificarFn)(const unsigned char *b, IdxBloque *m);
+
+/*--- escalar ---*/
+static void clasificar_escalar(const unsigned char *b, IdxBloque *m){
+    uint64_t est = 0, com = 0, bar = 0, esp = 0, nl = 0;
+    for (int i = 0; i < IDX_BLOQUE; i++){
+        unsigned c = clase[b[i]];
+        if (!c) continue;
+        uint64_t bit = 1ULL << i;
+        if (c & C_EST) est |= bit;
+        if (c & C_COM) com |= bit;
+        if (c & C_BAR) bar |= bit;
+        if (c & C_ESP) esp |= bit;
+        if (c & C_NL)  nl  |= bit;
+    }
+    m->estructural = est; m->comillas = com; m->barras = bar;
+    m->espacios = esp; m->saltos = nl;
+}
+
+#ifdef IDX_X86
+#ifdef __SSE2__
+/* '[' y '{' (y ']' y '}') difieren solo en el bit 0x20: se comparan juntos.
+ * Solo SSE2, que en x86-64 siempre esta: no hace falta preguntarle a la CPU */
+static void clasificar_sse2(const unsigned char *b, IdxBloque *m){
+    const __m128i k20 = _mm_set1_epi8(0x20);
+    uint64_t est = 0, com = 0, bar = 0, esp = 0, nl = 0;
+    for (int i = 0; i < 4; i++){
+        __m128i v = _mm_loadu_si128((const __m128i*)(b + 16*i));
+        __m128i lo = _mm_or_si128(v, k20);
+        __m128i e = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(lo, _mm_set1_epi8('{')),
+                         _mm_cmpeq_epi8(lo, _mm_set1_epi8('}'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8(':'))));
+        __m128i n = _mm_cmpeq_epi8(v, _mm_set1_epi8('\n'));
+        __m128i s = _mm_or_si128(
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                         _mm_cmpeq_epi8(v, _mm_set1_epi8('\t'))),
+            _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('\r')), n));
+        int sh = 16*i;
+        est |= (uint64_t)(uint16_t)_mm_movemask_epi8(e) << sh;
+        com |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('"'))) << sh;
+        bar |= (uint64_t)(uint16_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, _mm_set1_epi8('\\'))) << sh;
+        esp |= (uint64_t)(uint16_t)_mm_movemask_epi8(s) << sh;
+        nl  |= (uint64_t)(uint16_t)_mm_movemask_epi8(n) << sh;
+    }
+    m->estructural = est; m->comillas = com; m->barras = bar;
+    m->espacios = esp; m->saltos = nl;
+}
+#endif
+
+__attribute__((target("avx2")))
+static void clasificar_avx2(const unsigned char *b, IdxBloque *m){
+    const __m256i k20 = _mm256_set1_epi8(0x20);
+    uint64_t est = 0, com = 0, bar = 0, esp = 0, nl = 0;
+    for (int i = 0; i < 2; i++){
+        __m256i v = _mm256_loadu_si256((const __m256i*)(b + 32*i));
+        __m256i lo = _mm256_or_si256(v, k20);
+        __m256i e = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(lo, _mm256_set1_epi8('{')),
+                            _mm256_cmpeq_epi8(lo, _mm256_set1_epi8('}'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(',')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8(':'))));
+        __m256i n = _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n'));
+        __m256i s = _mm256_or_si256(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')),
+                            _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\t'))),
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\r')), n));
+        int sh = 32*i;
+        est |= (uint64_t)(uint32_t)_mm256_movemask_epi8(e) << sh;
+        com |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"'))) << sh;
+        bar |= (uint64_t)(uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\'))) << sh;
+        esp |= (uint64_t)(uint32_t)_mm256_movemask_epi8(s) << sh;
+        nl  |= (uint64_t)(uint32_t)_mm256_movemask_epi8(n) << sh;
+    }
+    m->estructural = est; m->comillas = com; m->barras = bar;
+    m->espacios = esp; m->saltos = nl;
+}
+#endif
+
+/*--- despacho en tiempo de ejecucion ---*/
+static ClasificarFn clasificar_fn = NULL;
+static const char *clasificar_nombre = "escalar";
+
+static void elegir(void){
+    const char *forzar = getenv("JSON_SIMD");
+    clasificar_fn = clasificar_escalar;
+    clasificar_nombre = "escalar";
+#ifdef IDX_X86
+    __builtin_cpu_init();
+    if (forzar && strcmp(forzar, "escalar") == 0) return;
+#ifdef __SSE2__
+    clasificar_fn = clasificar_sse2; clasificar_nombre = "sse2";
+    if (forzar && strcmp(forzar, "sse2") == 0) return;
+#endif
+    if (__builtin_cpu_supports("avx2")){
+        clasificar_fn = clasificar_avx2; clasificar_nombre = "avx2";
+    }
+#else
+    (void)forzar;
+#endif
+}
+
+const char *idx_implementacion(void){
+    if (!clasificar_fn) elegir();
+    return clasificar_nombre;
+}
+
+static void clasificar_bloque(const char *buf, size_t len, IdxBloque *m){
+    if (len >= IDX_BLOQUE){
+        clasificar_fn((const unsigned char*)buf, m);
+        return;
+    }
+    /* ultimo bloque incompleto: se rellena con un byte sin clase */
+    unsigned char tmp[IDX_BLOQUE];
+    memcpy(tmp, buf, len);
+    memset(tmp + len, 'a', IDX_BLOQUE - len);
+    clasificar_fn(tmp, m);
+}
+
+void idx_clasificar(const char *buf, size_t len, IdxBloque *out){
+    if (!clasificar_fn) elegir();
+    for (size_t i = 0; i < len; i += IDX_BLOQUE, out++)
+        clasificar_bloque(buf + i, len - i, out);
+}
+
+void idx_iniciar(IdxEstado *st){
+    st->escapado = 0; st->en_cadena = 0; st->escalar = 0;
+}
+
+/* Bytes escapados por una barra invertida no escapada. Las barras son raras:
+ * se recorren de a una. */
+static uint64_t escapados(uint64_t barras, uint64_t *acarreo){
+    uint64_t esc = *acarreo;
+    barras &= ~esc;
+    *acarreo = 0;
+    while (barras){
+        int i = idx_ctz(barras);
+        if (i == 63){ *acarreo = 1; break; }
+        uint64_t sig = 1ULL << (i + 1);
+        esc |= sig;
+        barras &= ~(sig | (sig >> 1));   /* la barra y el byte que escapa */
+    }
+    return esc;
+}
+
+/* xor prefijo: el bit i queda en 1 si hay un numero impar de bits en [0, i] */
+static uint64_t xor_prefijo(uint64_t x){
+    x ^= x << 1;  x ^= x << 2;  x ^= x << 4;
+    x ^= x << 8;  x ^= x << 16; x ^= x << 32;
+    return x;
+}
+
+size_t idx_tramo(IdxEstado *st, const char *buf, size_t len, uint32_t *pos){
+    size_t n = 0;
+    if (!clasificar_fn) elegir();
+    for (size_t base = 0; base < len; base += IDX_BLOQUE){
+        size_t resto = len - base;
+        IdxBloque m;
+        clasificar_bloque(buf + base, resto, &m);
+        uint64_t validos = resto >= IDX_BLOQUE ? ~0ULL : ((1ULL << resto) - 1);
+
+        uint64_t comillas = m.comillas & ~escapados(m.barras, &st->escapado);
+        uint64_t cadena = xor_prefijo(comillas) ^ st->en_cadena;   /* incluye la comilla de apertura */
+        st->en_cadena = (uint64_t)((int64_t)cadena >> 63);
+
+        uint64_t escalar = ~(m.estructural | m.espacios | m.comillas | cadena) & validos;
+        uint64_t inicio_escalar = escalar & ~((escalar << 1) | st->escalar);
+        st->escalar = escalar >> 63;
+
+        uint64_t bits = (m.estructural & ~cadena) | (comillas & cadena) | inicio_escalar;
+        while (bits){
+            pos[n++] = (uint32_t)(base + idx_ctz(bits));
+            bits &= bits - 1;
+        }
+    }
+    return n;
+}
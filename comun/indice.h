@@ -0,0 +1,68 @@
+/* indice.h - Clasificacion vectorizada de caracteres JSON e indice estructural
+ *
+ * Primera pasada comun a los tres analizadores: recorre la entrada de a
+ * 64 bytes (AVX2, SSE2 o escalar segun la CPU, elegido en tiempo de
+ * ejecucion) y produce mascaras de bits por bloque y, sobre ellas, el
+ * indice de posiciones estructurales fuera de cadenas.
+ */
+#ifndef INDICE_H
+#define INDICE_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define IDX_BLOQUE 64
+
+/* Mascaras de un bloque de 64 bytes: el bit i describe el byte i.
+ * Los bytes de relleno (mas alla del largo pedido) quedan en 0. */
+typedef struct {
+    uint64_t estructural;  /* [ ] { } , : */
+    uint64_t comillas;     /* "            */
+    uint64_t barras;       /* \            */
+    uint64_t espacios;     /* ' ' \t \r \n */
+    uint64_t saltos;       /* \n           */
+} IdxBloque;
+
+/* Acarreo entre tramos consecutivos de idx_tramo. */
+typedef struct {
+    uint64_t escapado;    /* 1 si el primer byte del tramo siguiente esta escapado */
+    uint64_t en_cadena;   /* ~0 si el tramo anterior termino dentro de una cadena */
+    uint64_t escalar;     /* 1 si el ultimo byte anterior era parte de un escalar */
+} IdxEstado;
+
+/* Clasifica buf[0..len) en (len+63)/64 bloques. */
+void idx_clasificar(const char *buf, size_t len, IdxBloque *out);
+
+void idx_iniciar(IdxEstado *st);
+
+/* Indexa un tramo de la entrada y escribe en pos (capacidad >= len) las
+ * posiciones, relativas a buf, de:
+ *   - los caracteres [ ] { } , : fuera de cadenas,
+ *   - las comillas que abren una cadena,
+ *   - el primer byte de cada escalar (numero, palabra clave u otro).
+ * Los tramos deben pasarse en orden y, salvo el ultimo, con largo
+ * multiplo de IDX_BLOQUE. Devuelve la cantidad de posiciones. */
+size_t idx_tramo(IdxEstado *st, const char *buf, size_t len, uint32_t *pos);
+
+/* "avx2", "sse2" o "escalar"; la variable de entorno JSON_SIMD fuerza una. */
+const char *idx_implementacion(void);
+
+static inline int idx_ctz(uint64_t x){
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#else
+    int n = 0;
+    while (!(x & 1)) { x >>= 1; n++; }
+    return n;
+#endif
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
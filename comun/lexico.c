@@ -0,0 +1,207 @@
+/* lexico.c - ver lexico.h */
+
+#include <stdint.h>
+#include "lexico.h"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+/* Particion completa de los 256 bytes, sin entradas que se pisen */
+const unsigned char lx_clase[256] = {
+    [0 ... 8] = LXC_OTRO, ['\t'] = LXC_BLANCO, ['\n'] = LXC_SALTO,
+    [11 ... 12] = LXC_OTRO, ['\r'] = LXC_BLANCO, [14 ... 31] = LXC_OTRO,
+    [' '] = LXC_BLANCO, ['!'] = LXC_OTRO, ['"'] = LXC_COMILLA,
+    ['#' ... '*'] = LXC_OTRO, ['+'] = LXC_MAS, [','] = LXC_COMA,
+    ['-'] = LXC_MENOS, ['.'] = LXC_PUNTO, ['/'] = LXC_OTRO,
+    ['0'] = LXC_CERO, ['1' ... '9'] = LXC_DIGITO, [':'] = LXC_DOS_PUNTOS,
+    [';' ... '@'] = LXC_OTRO,
+    ['A' ... 'D'] = LXC_LETRA, ['E'] = LXC_E, ['F' ... 'Z'] = LXC_LETRA,
+    ['['] = LXC_CORCHETE_A, ['\\'] = LXC_OTRO, [']'] = LXC_CORCHETE_C,
+    ['^' ... '`'] = LXC_OTRO,
+    ['a' ... 'd'] = LXC_LETRA, ['e'] = LXC_E, ['f' ... 'z'] = LXC_LETRA,
+    ['{'] = LXC_LLAVE_A, ['|'] = LXC_OTRO, ['}'] = LXC_LLAVE_C,
+    ['~' ... 255] = LXC_OTRO,
+};
+
+/* Toda fila termina el escalar en un delimitador; lo no listado va a LXA_MALO. */
+#define DELIMITA \
+    [LXC_LLAVE_A] = LXA_FIN, [LXC_LLAVE_C] = LXA_FIN, \
+    [LXC_CORCHETE_A] = LXA_FIN, [LXC_CORCHETE_C] = LXA_FIN, \
+    [LXC_COMA] = LXA_FIN, [LXC_DOS_PUNTOS] = LXA_FIN, \
+    [LXC_COMILLA] = LXA_FIN, [LXC_BLANCO] = LXA_FIN, [LXC_SALTO] = LXA_FIN
+#define DIGITOS(e) [LXC_CERO] = (e), [LXC_DIGITO] = (e)
+
+/* numero -> -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)?
+ * palabra -> [a-zA-Z]+ (luego se busca en la tabla de palabras clave) */
+const unsigned char lx_afd[LXA_N][LXC_N] = {
+    [LXA_MALO]      = { DELIMITA },
+    [LXA_INICIO]    = { DELIMITA, [LXC_CERO] = LXA_CERO, [LXC_DIGITO] = LXA_ENTERO,
+                        [LXC_MENOS] = LXA_MENOS,
+                        [LXC_E] = LXA_PALABRA, [LXC_LETRA] = LXA_PALABRA },
+    [LXA_MENOS]     = { DELIMITA, [LXC_CERO] = LXA_CERO, [LXC_DIGITO] = LXA_ENTERO },
+    [LXA_CERO]      = { DELIMITA, [LXC_PUNTO] = LXA_PUNTO, [LXC_E] = LXA_EXP },
+    [LXA_ENTERO]    = { DELIMITA, DIGITOS(LXA_ENTERO),
+                        [LXC_PUNTO] = LXA_PUNTO, [LXC_E] = LXA_EXP },
+    [LXA_PUNTO]     = { DELIMITA, DIGITOS(LXA_FRACCION) },
+    [LXA_FRACCION]  = { DELIMITA, DIGITOS(LXA_FRACCION), [LXC_E] = LXA_EXP },
+    [LXA_EXP]       = { DELIMITA, DIGITOS(LXA_EXP_DIG),
+                        [LXC_MAS] = LXA_EXP_SIGNO, [LXC_MENOS] = LXA_EXP_SIGNO },
+    [LXA_EXP_SIGNO] = { DELIMITA, DIGITOS(LXA_EXP_DIG) },
+    [LXA_EXP_DIG]   = { DELIMITA, DIGITOS(LXA_EXP_DIG) },
+    [LXA_PALABRA]   = { DELIMITA, [LXC_E] = LXA_PALABRA, [LXC_LETRA] = LXA_PALABRA },
+};
+
+#undef DELIMITA
+#undef DIGITOS
+
+size_t lx_escalar(unsigned char *estado, const char *s, size_t n){
+    unsigned e = *estado;
+    size_t i;
+    for (i = 0; i < n; i++){
+        unsigned sig = lx_afd[e][lx_clase[(unsigned char)s[i]]];
+        if (sig == LXA_FIN) break;
+        e = sig;
+    }
+    *estado = (unsigned char)e;
+    return i;
+}
+
+LxTipo lx_fin_escalar(unsigned char e, const char *s, size_t n){
+    switch (e){
+        case LXA_CERO: case LXA_ENTERO: case LXA_FRACCION: case LXA_EXP_DIG:
+            return LX_NUMERO;
+        case LXA_PALABRA:
+            return lx_palabra(s, n);
+        default:
+            return LX_ERROR;
+    }
+}
+
+/* Palabras clave empaquetadas en minusculas, un byte por letra. La ranura
+ * sale del largo y la primera letra: (4+'t')&3=0, (4+'n')&3=2, (5+'f')&3=3. */
+#define EMPAQUETAR(a,b,c,d,e) \
+    ((uint64_t)(a) | (uint64_t)(b) << 8 | (uint64_t)(c) << 16 | \
+     (uint64_t)(d) << 24 | (uint64_t)(e) << 32)
+
+static const struct { uint64_t letras; LxTipo tipo; } palabras[4] = {
+    [0] = { EMPAQUETAR('t','r','u','e',0),   LX_TRUE  },
+    [1] = { 0,                               LX_ERROR },
+    [2] = { EMPAQUETAR('n','u','l','l',0),   LX_NULL  },
+    [3] = { EMPAQUETAR('f','a','l','s','e'), LX_FALSE },
+};
+
+LxTipo lx_palabra(const char *s, size_t n){
+    if (n < 4 || n > 5) return LX_ERROR;
+    uint64_t w = 0;
+    for (size_t i = 0; i < n; i++)
+        w |= (uint64_t)((unsigned char)s[i] | 0x20) << (8*i);   /* a minuscula */
+    unsigned r = (unsigned)(n + ((unsigned char)s[0] | 0x20)) & 3;
+    return w == palabras[r].letras ? palabras[r].tipo : LX_ERROR;
+}
+
+size_t lx_cadena(const char *s, size_t n){
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i com = _mm_set1_epi8('"'), bar = _mm_set1_epi8('\\');
+    for (; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, com),
+                                               _mm_cmpeq_epi8(v, bar)));
+        if (m) return i + (size_t)__builtin_ctz((unsigned)m);
+    }
+#endif
+    for (; i < n; i++)
+        if (s[i] == '"' || s[i] == '\\') return i;
+    return n;
+}
+
+size_t lx_cadena_linea(const char *s, size_t n){
+    size_t i = 0;
+#ifdef __SSE2__
+    const __m128i com = _mm_set1_epi8('"'), bar = _mm_set1_epi8('\\'), nl = _mm_set1_epi8('\n');
+    for (; i + 16 <= n; i += 16){
+        __m128i v = _mm_loadu_si128((const __m128i*)(s + i));
+        int m = _mm_movemask_epi8(_mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, com),
+                                                            _mm_cmpeq_epi8(v, bar)),
+                                               _mm_cmpeq_epi8(v, nl)));
+        if (m) return i + (size_t)__builtin_ctz((unsigned)m);
+    }
+#endif
+    for (; i < n; i++)
+        if (s[i] == '"' || s[i] == '\\' || s[i] == '\n') return i;
+    return n;
+}
+
+/* Valor de cada digito hexadecimal; 0x10 marca los demas bytes. Como
+ * lx_clase, una particion sin entradas que se pisen. */
+static const unsigned char hex_valor[256] = {
+    [0 ... '/'] = 0x10,
+    ['0'] = 0, ['1'] = 1, ['2'] = 2, ['3'] = 3, ['4'] = 4,
+    ['5'] = 5, ['6'] = 6, ['7'] = 7, ['8'] = 8, ['9'] = 9,
+    [':' ... '@'] = 0x10,
+    ['A'] = 10, ['B'] = 11, ['C'] = 12, ['D'] = 13, ['E'] = 14, ['F'] = 15,
+    ['G' ... '`'] = 0x10,
+    ['a'] = 10, ['b'] = 11, ['c'] = 12, ['d'] = 13, ['e'] = 14, ['f'] = 15,
+    ['g' ... 255] = 0x10,
+};
+
+/* Valor de los 4 digitos hexadecimales de s, o -1 */
+static long hex4(const char *s){
+    const unsigned char *u = (const unsigned char*)s;
+    unsigned a = hex_valor[u[0]], b = hex_valor[u[1]], c = hex_valor[u[2]], d = hex_valor[u[3]];
+    if ((a | b | c | d) & 0x10) return -1;
+    return (long)(a << 12 | b << 8 | c << 4 | d);
+}
+
+static size_t utf8_poner(unsigned long c, char *out){
+    unsigned char *o = (unsigned char*)out;
+    if (c < 0x80){ o[0] = (unsigned char)c; return 1; }
+    if (c < 0x800){
+        o[0] = (unsigned char)(0xC0 | c >> 6);
+        o[1] = (unsigned char)(0x80 | (c & 0x3F));
+        return 2;
+    }
+    if (c < 0x10000){
+        o[0] = (unsigned char)(0xE0 | c >> 12);
+        o[1] = (unsigned char)(0x80 | (c >> 6 & 0x3F));
+        o[2] = (unsigned char)(0x80 | (c & 0x3F));
+        return 3;
+    }
+    o[0] = (unsigned char)(0xF0 | c >> 18);
+    o[1] = (unsigned char)(0x80 | (c >> 12 & 0x3F));
+    o[2] = (unsigned char)(0x80 | (c >> 6 & 0x3F));
+    o[3] = (unsigned char)(0x80 | (c & 0x3F));
+    return 4;
+}
+
+size_t lx_escape(const char *s, size_t n, char *out, size_t *k){
+    if (n < 2) return 0;
+    char c = s[1];
+    switch (c){
+        case '"': case '\\': case '/': break;
+        case 'b': c = '\b'; break;
+        case 'f': c = '\f'; break;
+        case 'n': c = '\n'; break;
+        case 'r': c = '\r'; break;
+        case 't': c = '\t'; break;
+        case 'u': {
+            long u = n >= 6 ? hex4(s + 2) : -1;
+            if (u < 0) return 0;
+            size_t usados = 6;
+            if (u >= 0xD800 && u <= 0xDBFF && n >= 12 && s[6] == '\\' && s[7] == 'u'){
+                long v = hex4(s + 8);
+                if (v >= 0xDC00 && v <= 0xDFFF){
+                    u = 0x10000 + ((u - 0xD800) << 10) + (v - 0xDC00);
+                    usados = 12;
+                }
+            }
+            if (u >= 0xD800 && u <= 0xDFFF) u = 0xFFFD;   /* suplente suelto */
+            *k = utf8_poner((unsigned long)u, out);
+            return usados;
+        }
+        default: return 0;
+    }
+    out[0] = c; *k = 1;
+    return 2;
+}
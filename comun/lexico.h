@@ -0,0 +1,95 @@
+/* lexico.h - Nucleo lexico comun a los tres analizadores
+ *
+ * Tablas construidas en tiempo de compilacion: la clase de cada byte y el
+ * automata (AFD) que reconoce los escalares. Un escalar es la corrida de
+ * bytes hasta el proximo delimitador (blanco, signo o comilla); al
+ * terminarla el estado final dice si fue un numero, una palabra clave
+ * (true/false/null, sin distinguir mayusculas) o un error. Cada
+ * herramienta pone su propia lectura (bloques, lineas, mmap) alrededor.
+ */
+#ifndef LEXICO_H
+#define LEXICO_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Tipos de token. Las tres herramientas usan los mismos valores. */
+typedef enum {
+    LX_LLAVE_A, LX_LLAVE_C, LX_CORCHETE_A, LX_CORCHETE_C,
+    LX_COMA, LX_DOS_PUNTOS,
+    LX_CADENA, LX_NUMERO,
+    LX_TRUE, LX_FALSE, LX_NULL,
+    LX_FIN, LX_ERROR
+} LxTipo;
+
+/* Clases de byte. Los seis signos valen lo mismo que su LxTipo; todo lo
+ * que esta despues de LXC_SALTO forma parte de un escalar. */
+enum {
+    LXC_LLAVE_A = LX_LLAVE_A, LXC_LLAVE_C = LX_LLAVE_C,
+    LXC_CORCHETE_A = LX_CORCHETE_A, LXC_CORCHETE_C = LX_CORCHETE_C,
+    LXC_COMA = LX_COMA, LXC_DOS_PUNTOS = LX_DOS_PUNTOS,
+    LXC_COMILLA,
+    LXC_BLANCO,     /* ' ' \t \r */
+    LXC_SALTO,      /* \n */
+    LXC_CERO, LXC_DIGITO, LXC_MENOS, LXC_MAS, LXC_PUNTO,
+    LXC_E,          /* e E (tambien letra) */
+    LXC_LETRA,
+    LXC_OTRO,
+    LXC_N
+};
+
+/* Estados del AFD de escalares. LXA_FIN no es un estado: marca que el
+ * byte leido es un delimitador y el escalar termino antes de el. */
+enum {
+    LXA_MALO,       /* sumidero: la corrida ya no puede ser un token valido */
+    LXA_INICIO, LXA_MENOS, LXA_CERO, LXA_ENTERO, LXA_PUNTO, LXA_FRACCION,
+    LXA_EXP, LXA_EXP_SIGNO, LXA_EXP_DIG,
+    LXA_PALABRA,
+    LXA_FIN,
+    LXA_N = LXA_FIN
+};
+
+extern const unsigned char lx_clase[256];
+extern const unsigned char lx_afd[LXA_N][LXC_N];
+
+/* Avanza el AFD desde *estado sobre s[0..n). Devuelve los bytes que
+ * pertenecen al escalar: si es menor que n, s[devuelto] es el delimitador
+ * que lo cierra; si es n, el escalar puede seguir en el proximo tramo. */
+size_t lx_escalar(unsigned char *estado, const char *s, size_t n);
+
+/* Tipo del escalar s[0..n) que dejo el AFD en el estado e. */
+LxTipo lx_fin_escalar(unsigned char e, const char *s, size_t n);
+
+/* true/false/null sin distinguir mayusculas, con una sola consulta a la
+ * tabla de palabras; LX_ERROR si no es ninguna. s[0..n) son solo letras. */
+LxTipo lx_palabra(const char *s, size_t n);
+
+/* Dentro de una cadena: posicion del primer '"' o '\\' en s[0..n), o n. */
+size_t lx_cadena(const char *s, size_t n);
+
+/* Cadenas del lexer y del sintactico, que van por lineas y comparten los
+ * tokens (flujo.h): una cadena termina en su comilla o antes del '\n' que
+ * corta la linea, aunque este escapado; ese '\n' queda afuera, como salto.
+ * Una barra invertida escapa cualquier otro byte. Igual que lx_cadena
+ * pero tambien se detiene en el primer '\n'. */
+size_t lx_cadena_linea(const char *s, size_t n);
+
+/* Bytes que puede ocupar un escape en la fuente: un par de suplentes,
+ * \uD83D\uDE00, es un solo caracter */
+#define LX_ESCAPE_MAX 12
+
+/* Decodifica el escape que empieza en s[0] == '\\': \" \\ \/ \b \f \n \r
+ * \t o \uXXXX. s[0..n) tiene que tener LX_ESCAPE_MAX bytes, salvo al final
+ * de la entrada. Deja el caracter en UTF-8 en out (hasta 4 bytes) y en *k
+ * cuantos son. Devuelve los bytes de s que usa, o 0 si no es un escape de
+ * JSON. Un suplente sin su pareja sale como U+FFFD. */
+size_t lx_escape(const char *s, size_t n, char *out, size_t *k);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
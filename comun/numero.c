@@ -0,0 +1,240 @@
+/* numero.c - ver numero.h */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <float.h>
+#include "numero.h"
+#include "potencias5.h"
+
+#define INF_BITS  0x7FF0000000000000ULL
+#define MANT_BITS 52
+
+/* a*b en 128 bits */
+static inline void mul128(uint64_t a, uint64_t b, uint64_t *hi, uint64_t *lo){
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *hi = (uint64_t)(r >> 64);
+    *lo = (uint64_t)r;
+#else
+    uint64_t a0 = (uint32_t)a, a1 = a >> 32, b0 = (uint32_t)b, b1 = b >> 32;
+    uint64_t p00 = a0*b0, p01 = a0*b1, p10 = a1*b0, p11 = a1*b1;
+    uint64_t mid = (p00 >> 32) + (uint32_t)p01 + (uint32_t)p10;
+    *lo = (mid << 32) | (uint32_t)p00;
+    *hi = p11 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+/* Eisel-Lemire: bits del double (sin signo) mas cercano a w * 10^q, w != 0.
+ * w se normaliza a 64 bits y se multiplica por la aproximacion de 5^q; la
+ * potencia de 2 sale de q con log2(10) en punto fijo. Con la tabla de 128
+ * bits el resultado siempre queda determinado (Mushtak y Lemire, 2023). */
+static uint64_t eisel_lemire(uint64_t w, int64_t q){
+    if (q < POT5_MIN) return 0;
+    if (q > POT5_MAX) return INF_BITS;
+    int lz = __builtin_clzll(w);
+    w <<= lz;
+    const uint64_t *p5 = &potencias5[2 * (q - POT5_MIN)];
+    uint64_t hi, lo;
+    mul128(w, p5[0], &hi, &lo);
+    if ((hi & 0x1FF) == 0x1FF){        /* los 9 bits de redondeo son dudosos */
+        uint64_t hi2, lo2;
+        mul128(w, p5[1], &hi2, &lo2);
+        lo += hi2;
+        if (hi2 > lo) hi++;
+    }
+    int alto = (int)(hi >> 63);
+    int corrimiento = alto + 64 - MANT_BITS - 3;
+    uint64_t m = hi >> corrimiento;
+    int32_t e2 = (int32_t)((((152170 + 65536) * (int32_t)q) >> 16) + 63) + alto - lz + 1023;
+
+    if (e2 <= 0){                      /* subnormal */
+        if (-e2 + 1 >= 64) return 0;
+        m >>= -e2 + 1;
+        m += m & 1;
+        m >>= 1;
+        /* si el redondeo llego a 2^52 es el menor normal: m | 1<<52 */
+        return m | ((uint64_t)(m >= (1ULL << MANT_BITS)) << MANT_BITS);
+    }
+    /* justo en el medio con 5^q exacto: redondear al par */
+    if (lo <= 1 && q >= -4 && q <= 23 && (m & 3) == 1 && (m << corrimiento) == hi)
+        m &= ~(uint64_t)1;
+    m += m & 1;
+    m >>= 1;
+    if (m >= (2ULL << MANT_BITS)){ m = 1ULL << MANT_BITS; e2++; }
+    m &= ~(1ULL << MANT_BITS);
+    if (e2 >= 0x7FF) return INF_BITS;
+    return ((uint64_t)e2 << MANT_BITS) | m;
+}
+
+static double de_bits(uint64_t b, int neg){
+    double d;
+    b |= (uint64_t)neg << 63;
+    memcpy(&d, &b, sizeof d);
+    return d;
+}
+
+/* w * 10^q con signo. Las potencias de 10 hasta 10^22 son exactas en double:
+ * si w cabe en 53 bits basta una multiplicacion o division (Clinger). Con
+ * x87 (FLT_EVAL_METHOD != 0) habria doble redondeo y se omite. */
+static double a_double(uint64_t w, int64_t q, int neg){
+#if defined(FLT_EVAL_METHOD) && FLT_EVAL_METHOD == 0
+    static const double p10[] = {
+        1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+        1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+    };
+    if (q >= -22 && q <= 22 && w <= (1ULL << 53)){
+        double d = (double)w;
+        d = q < 0 ? d / p10[-q] : d * p10[q];
+        return neg ? -d : d;
+    }
+#endif
+    if (w == 0) return neg ? -0.0 : 0.0;
+    return de_bits(eisel_lemire(w, q), neg);
+}
+
+/* Ultimo recurso para mantisas de mas de 19 cifras: strtod sobre una copia
+ * terminada en '\0' (el lexema suele ser una vista sin terminar). */
+static double por_strtod(const char *s, size_t n){
+    char local[128];
+    char *c = n < sizeof local ? local : (char*)malloc(n + 1);
+    if (!c) return 0;
+    memcpy(c, s, n);
+    c[n] = '\0';
+    double d = strtod(c, NULL);
+    if (c != local) free(c);
+    return d;
+}
+
+#define ES_DIGITO(c) ((unsigned)((c) - '0') < 10)
+#define EXP_TOPE 100000   /* exponentes mas grandes ya dan 0 o infinito */
+
+NumTipo num_leer(const char *s, size_t n, Numero *v){
+    const char *p = s, *fin = s + n;
+    int neg = 0, cifras = 0, truncado = 0, entero = 1;
+    uint64_t w = 0;
+    int64_t q = 0;
+
+    if (p < fin && *p == '-'){ neg = 1; p++; }
+    if (p == fin || !ES_DIGITO(*p)) return v->tipo = NUM_ERROR;
+    /* parte entera: a lo sumo 19 cifras significativas en w; las que sobran
+     * solo corren el exponente */
+    if (*p == '0'){
+        p++;
+        if (p < fin && ES_DIGITO(*p)) return v->tipo = NUM_ERROR;
+    } else {
+        for (; p < fin && ES_DIGITO(*p); p++){
+            if (cifras < 19){ w = w * 10 + (uint64_t)(*p - '0'); cifras++; }
+            else { q++; truncado |= *p != '0'; }
+        }
+    }
+    if (p < fin && *p == '.'){
+        const char *f = ++p;
+        entero = 0;
+        for (; p < fin && ES_DIGITO(*p); p++){
+            if (cifras < 19){
+                w = w * 10 + (uint64_t)(*p - '0');
+                q--;
+                if (w) cifras++;          /* los ceros iniciales no cuentan */
+            } else truncado |= *p != '0';
+        }
+        if (p == f) return v->tipo = NUM_ERROR;
+    }
+    if (p < fin && (*p == 'e' || *p == 'E')){
+        int eneg = 0;
+        int64_t e = 0;
+        entero = 0;
+        p++;
+        if (p < fin && (*p == '-' || *p == '+')){ eneg = *p == '-'; p++; }
+        if (p == fin || !ES_DIGITO(*p)) return v->tipo = NUM_ERROR;
+        for (; p < fin && ES_DIGITO(*p); p++)
+            if (e < EXP_TOPE) e = e * 10 + (*p - '0');
+        q += eneg ? -e : e;
+    }
+    if (p != fin) return v->tipo = NUM_ERROR;
+
+    v->dec = !truncado && cifras <= 15 ? w : 0;
+    v->dec_exp = (int32_t)q;
+    if (entero && !truncado && q == 0 && w <= (uint64_t)INT64_MAX + neg){
+        v->entero = neg ? (int64_t)(0 - w) : (int64_t)w;
+        v->real = neg ? -(double)w : (double)w;
+        return v->tipo = NUM_ENTERO;
+    }
+    v->real = a_double(w, q, neg);
+    /* con cifras descartadas el valor esta entre w y w+1 (por 10^q): si los
+     * dos extremos redondean igual ese es el resultado */
+    if (truncado && a_double(w + 1, q, neg) != v->real)
+        v->real = por_strtod(s, n);
+    return v->tipo = NUM_REAL;
+}
+
+/*--- forma canonica ---*/
+static size_t escribir_entero(int64_t x, char *out){
+    char tmp[20];
+    size_t n = 0, k = 0;
+    uint64_t u = x < 0 ? 0 - (uint64_t)x : (uint64_t)x;
+    do { tmp[n++] = (char)('0' + u % 10); u /= 10; } while (u);
+    if (x < 0) out[k++] = '-';
+    while (n) out[k++] = tmp[--n];
+    return k;
+}
+
+/* Cifras c[0..k) (sin ceros al final) con el punto decimal despues de la
+ * cifra p, segun Number.toString: notacion comun para -6 < p <= 21. */
+static size_t formatear(int neg, const char *c, int k, int p, char *out){
+    size_t n = 0;
+    if (neg) out[n++] = '-';
+    if (k <= p && p <= 21){                   /* 1500 */
+        memcpy(out + n, c, (size_t)k); n += (size_t)k;
+        for (int i = k; i < p; i++) out[n++] = '0';
+    } else if (0 < p && p <= 21){             /* 1.5 */
+        memcpy(out + n, c, (size_t)p); n += (size_t)p;
+        out[n++] = '.';
+        memcpy(out + n, c + p, (size_t)(k - p)); n += (size_t)(k - p);
+    } else if (-6 < p && p <= 0){             /* 0.0015 */
+        out[n++] = '0'; out[n++] = '.';
+        for (int i = p; i < 0; i++) out[n++] = '0';
+        memcpy(out + n, c, (size_t)k); n += (size_t)k;
+    } else {                                  /* 1.5e+21, 1.5e-7 */
+        out[n++] = c[0];
+        if (k > 1){ out[n++] = '.'; memcpy(out + n, c + 1, (size_t)(k - 1)); n += (size_t)(k - 1); }
+        out[n++] = 'e';
+        out[n++] = p - 1 < 0 ? '-' : '+';
+        n += escribir_entero(p - 1 < 0 ? 1 - p : p - 1, out + n);
+    }
+    return n;
+}
+
+size_t num_canonico(const Numero *v, char *out){
+    if (v->tipo == NUM_ENTERO) return escribir_entero(v->entero, out);
+    double d = v->real, a = d < 0 ? -d : d;
+    if (d != d || d - d != 0) return 0;          /* NaN o infinito */
+    if (d == 0){ out[0] = '0'; return 1; }
+    char c[24];
+    int k = 0, p;
+    if (v->dec && a >= DBL_MIN){
+        /* un normal escrito con 15 cifras o menos vuelve a esas mismas
+         * cifras: no hace falta buscarlas */
+        uint64_t m = v->dec;
+        int32_t e = v->dec_exp;
+        while (m % 10 == 0){ m /= 10; e++; }
+        k = (int)escribir_entero((int64_t)m, c);
+        p = k + e;
+    } else {
+        /* la menor precision de %e que vuelve al mismo double (a lo sumo 17);
+         * con un normal alcanzan 15 cifras si las tiene, un subnormal no */
+        char tmp[NUM_CANON_MAX];
+        int n = 0;
+        for (int prec = a < DBL_MIN ? 1 : 15; prec <= 17; prec++){
+            Numero r;
+            n = snprintf(tmp, sizeof tmp, "%.*e", prec - 1, a);
+            if (prec == 17 || (num_leer(tmp, (size_t)n, &r) != NUM_ERROR && r.real == a)) break;
+        }
+        /* tmp = "d.ddde+XX" */
+        const char *x = tmp;
+        for (; *x != 'e'; x++) if (*x != '.') c[k++] = *x;
+        p = atoi(x + 1) + 1;
+        while (k > 1 && c[k-1] == '0') k--;
+    }
+    return formatear(d < 0, c, k, p, out);
+}
@@ -0,0 +1,46 @@
+/* numero.h - Conversion de numeros JSON a valores tipados
+ *
+ * Una sola pasada sobre el lexema: verifica la gramatica de numero de JSON
+ * y lo convierte a entero de 64 bits o a double sin strtod. Los enteros
+ * que entran en int64 quedan exactos; el resto se convierte con el
+ * algoritmo de Eisel-Lemire (producto por 5^q de 128 bits de una tabla),
+ * correctamente redondeado. Solo los numeros con mas de 19 cifras
+ * significativas cuya ultima cifra cambia el redondeo recurren a strtod.
+ */
+#ifndef NUMERO_H
+#define NUMERO_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum { NUM_ERROR, NUM_ENTERO, NUM_REAL } NumTipo;
+
+typedef struct {
+    NumTipo tipo;
+    int64_t entero;   /* NUM_ENTERO: sin parte fraccionaria ni exponente */
+    double real;      /* siempre (tambien para NUM_ENTERO) */
+    uint64_t dec;     /* != 0: el lexema vale exactamente dec * 10^dec_exp */
+    int32_t dec_exp;  /*        con a lo sumo 15 cifras significativas */
+} Numero;
+
+/* Convierte s[0..n). NUM_ERROR si no cumple
+ * -? (0 | [1-9][0-9]*) (. [0-9]+)? ([eE] [+-]? [0-9]+)? */
+NumTipo num_leer(const char *s, size_t n, Numero *v);
+
+/* Forma canonica en out (sin '\0'; caben NUM_CANON_MAX bytes): enteros en
+ * decimal; reales con la menor cantidad de cifras que vuelve al mismo
+ * double, escritos como Number.toString de JavaScript (la forma de RFC 8785:
+ * 150, 0.001, 1e+21, 1e-7). Devuelve 0 si el valor no es finito (p.ej.
+ * 1e400) y no tiene forma canonica. */
+#define NUM_CANON_MAX 32
+size_t num_canonico(const Numero *v, char *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
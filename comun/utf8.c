@@ -0,0 +1,268 @@
+/* utf8.c - ver utf8.h */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "utf8.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define UTF8_X86 1
+#include <immintrin.h>
+#endif
+
+/* Largo de la secuencia que empieza en s[0] si es valida, 0 si no lo es
+ * y -1 si lo que hay en s[0..n) es el comienzo valido de una mas larga. */
+static int secuencia(const unsigned char *s, size_t n){
+    unsigned c = s[0], min = 0x80, max = 0xBF;
+    size_t largo;
+    if (c < 0x80) return 1;
+    if (c < 0xC2) return 0;                       /* continuacion suelta o 2 bytes sobrelargo */
+    if (c < 0xE0) largo = 2;
+    else if (c < 0xF0){
+        largo = 3;
+        if (c == 0xE0) min = 0xA0;                /* sobrelargo */
+        else if (c == 0xED) max = 0x9F;           /* mitades de pares sustitutos */
+    } else if (c < 0xF5){
+        largo = 4;
+        if (c == 0xF0) min = 0x90;                /* sobrelargo */
+        else if (c == 0xF4) max = 0x8F;           /* mayor que U+10FFFF */
+    } else return 0;
+    for (size_t k = 1; k < largo; k++){
+        if (k >= n) return -1;
+        unsigned d = s[k];
+        if (k == 1 ? (d < min || d > max) : (d & 0xC0) != 0x80) return 0;
+    }
+    return (int)largo;
+}
+
+/* Primer byte de la primera secuencia invalida o sin terminar de s[0..n), o n */
+static size_t primer_error(const unsigned char *s, size_t n){
+    size_t i = 0;
+    while (i < n){
+        if (n - i >= 8){
+            uint64_t w;
+            memcpy(&w, s + i, 8);
+            if (!(w & 0x8080808080808080ULL)){ i += 8; continue; }
+        }
+        if (s[i] < 0x80){ i++; continue; }
+        int k = secuencia(s + i, n - i);
+        if (k <= 0) return i;
+        i += (size_t)k;
+    }
+    return n;
+}
+
+typedef int (*ValidoFn)(const unsigned char *s, size_t n);
+
+/*--- escalar ---*/
+static int valido_escalar(const unsigned char *s, size_t n){
+    return primer_error(s, n) == n;
+}
+
+#ifdef UTF8_X86
+/* Cada byte se mira junto con el anterior: tres tablas de 16 entradas
+ * (nibble alto y bajo del anterior, nibble alto del actual) dan un bit por
+ * clase de error y el AND de las tres deja solo los que aplican. Que el
+ * tercer y cuarto byte de una secuencia sean continuaciones se comprueba
+ * aparte, con los bytes de dos y tres posiciones atras. */
+enum {
+    CORTA = 1 << 0,        /* 11______ 0_______ o 11______ 11______ */
+    LARGA = 1 << 1,        /* 0_______ 10______ */
+    SOBRE3 = 1 << 2,       /* 11100000 100_____ */
+    GRANDE = 1 << 3,       /* 11110100 1001____ y mayores */
+    SUSTITUTO = 1 << 4,    /* 11101101 101_____ */
+    SOBRE2 = 1 << 5,       /* 1100000_ 10______ */
+    GRANDE_1000 = 1 << 6,  /* 11110101 1000____ y mayores */
+    SOBRE4 = 1 << 6,       /* 11110000 1000____ */
+    DOS_CONT = 1 << 7      /* 10______ 10______ */
+};
+#define ACARREO (CORTA | LARGA | DOS_CONT)
+
+static const unsigned char alto1[16] = {
+    LARGA, LARGA, LARGA, LARGA, LARGA, LARGA, LARGA, LARGA,
+    DOS_CONT, DOS_CONT, DOS_CONT, DOS_CONT,
+    CORTA | SOBRE2,
+    CORTA,
+    CORTA | SOBRE3 | SUSTITUTO,
+    CORTA | GRANDE | GRANDE_1000 | SOBRE4
+};
+static const unsigned char bajo1[16] = {
+    ACARREO | SOBRE3 | SOBRE2 | SOBRE4,
+    ACARREO | SOBRE2,
+    ACARREO,
+    ACARREO,
+    ACARREO | GRANDE,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000 | SUSTITUTO,
+    ACARREO | GRANDE | GRANDE_1000,
+    ACARREO | GRANDE | GRANDE_1000
+};
+static const unsigned char alto2[16] = {
+    CORTA, CORTA, CORTA, CORTA, CORTA, CORTA, CORTA, CORTA,
+    LARGA | SOBRE2 | DOS_CONT | SOBRE3 | GRANDE_1000 | SOBRE4,
+    LARGA | SOBRE2 | DOS_CONT | SOBRE3 | GRANDE,
+    LARGA | SOBRE2 | DOS_CONT | SUSTITUTO | GRANDE,
+    LARGA | SOBRE2 | DOS_CONT | SUSTITUTO | GRANDE,
+    CORTA, CORTA, CORTA, CORTA
+};
+/* Restando esto con saturacion, lo que queda en los ultimos bytes de un
+ * bloque es una secuencia que sigue en el proximo */
+static const unsigned char pendiente[32] = {
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255,
+    255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 255, 0xEF, 0xDF, 0xBF
+};
+
+__attribute__((target("sse4.2")))
+static int valido_sse42(const unsigned char *s, size_t n){
+    const __m128i t1 = _mm_loadu_si128((const __m128i*)alto1);
+    const __m128i t2 = _mm_loadu_si128((const __m128i*)bajo1);
+    const __m128i t3 = _mm_loadu_si128((const __m128i*)alto2);
+    const __m128i fin = _mm_loadu_si128((const __m128i*)(pendiente + 16));
+    const __m128i k0f = _mm_set1_epi8(0x0F), k80 = _mm_set1_epi8((char)0x80);
+    __m128i prev = _mm_setzero_si128(), error = prev, pend = prev;
+    unsigned char tmp[16];
+    for (size_t i = 0; i < n; i += 16){
+        __m128i v;
+        if (n - i >= 16) v = _mm_loadu_si128((const __m128i*)(s + i));
+        else {
+            /* el relleno con ceros es ASCII: una secuencia sin terminar da error */
+            memset(tmp, 0, sizeof tmp);
+            memcpy(tmp, s + i, n - i);
+            v = _mm_loadu_si128((const __m128i*)tmp);
+        }
+        if (!_mm_movemask_epi8(v)){
+            error = _mm_or_si128(error, pend);
+            pend = _mm_setzero_si128();
+            prev = v;
+            continue;
+        }
+        __m128i p1 = _mm_alignr_epi8(v, prev, 15);
+        __m128i p2 = _mm_alignr_epi8(v, prev, 14);
+        __m128i p3 = _mm_alignr_epi8(v, prev, 13);
+        __m128i e = _mm_and_si128(
+            _mm_and_si128(_mm_shuffle_epi8(t1, _mm_and_si128(_mm_srli_epi16(p1, 4), k0f)),
+                          _mm_shuffle_epi8(t2, _mm_and_si128(p1, k0f))),
+            _mm_shuffle_epi8(t3, _mm_and_si128(_mm_srli_epi16(v, 4), k0f)));
+        __m128i m23 = _mm_or_si128(_mm_subs_epu8(p2, _mm_set1_epi8((char)(0xE0 - 0x80))),
+                                   _mm_subs_epu8(p3, _mm_set1_epi8((char)(0xF0 - 0x80))));
+        error = _mm_or_si128(error, _mm_xor_si128(_mm_and_si128(m23, k80), e));
+        pend = _mm_subs_epu8(v, fin);
+        prev = v;
+    }
+    error = _mm_or_si128(error, pend);
+    return _mm_testz_si128(error, error);
+}
+
+__attribute__((target("avx2")))
+static int valido_avx2(const unsigned char *s, size_t n){
+    const __m256i t1 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)alto1));
+    const __m256i t2 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)bajo1));
+    const __m256i t3 = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)alto2));
+    const __m256i fin = _mm256_loadu_si256((const __m256i*)pendiente);
+    const __m256i k0f = _mm256_set1_epi8(0x0F), k80 = _mm256_set1_epi8((char)0x80);
+    __m256i prev = _mm256_setzero_si256(), error = prev, pend = prev;
+    unsigned char tmp[32];
+    for (size_t i = 0; i < n; i += 32){
+        __m256i v;
+        if (n - i >= 32) v = _mm256_loadu_si256((const __m256i*)(s + i));
+        else {
+            memset(tmp, 0, sizeof tmp);
+            memcpy(tmp, s + i, n - i);
+            v = _mm256_loadu_si256((const __m256i*)tmp);
+        }
+        if (!_mm256_movemask_epi8(v)){
+            error = _mm256_or_si256(error, pend);
+            pend = _mm256_setzero_si256();
+            prev = v;
+            continue;
+        }
+        /* los bytes anteriores cruzan la mitad de 128 bits del registro */
+        __m256i cruce = _mm256_permute2x128_si256(prev, v, 0x21);
+        __m256i p1 = _mm256_alignr_epi8(v, cruce, 15);
+        __m256i p2 = _mm256_alignr_epi8(v, cruce, 14);
+        __m256i p3 = _mm256_alignr_epi8(v, cruce, 13);
+        __m256i e = _mm256_and_si256(
+            _mm256_and_si256(_mm256_shuffle_epi8(t1, _mm256_and_si256(_mm256_srli_epi16(p1, 4), k0f)),
+                             _mm256_shuffle_epi8(t2, _mm256_and_si256(p1, k0f))),
+            _mm256_shuffle_epi8(t3, _mm256_and_si256(_mm256_srli_epi16(v, 4), k0f)));
+        __m256i m23 = _mm256_or_si256(_mm256_subs_epu8(p2, _mm256_set1_epi8((char)(0xE0 - 0x80))),
+                                      _mm256_subs_epu8(p3, _mm256_set1_epi8((char)(0xF0 - 0x80))));
+        error = _mm256_or_si256(error, _mm256_xor_si256(_mm256_and_si256(m23, k80), e));
+        pend = _mm256_subs_epu8(v, fin);
+        prev = v;
+    }
+    error = _mm256_or_si256(error, pend);
+    return _mm256_testz_si256(error, error);
+}
+#endif
+
+/*--- despacho en tiempo de ejecucion (JSON_SIMD, como indice.c: "sse2"
+ * fuerza la variante de 16 bytes, que aca tambien pide SSE4.2) ---*/
+static ValidoFn valido_fn = NULL;
+
+static void elegir(void){
+    const char *forzar = getenv("JSON_SIMD");
+    valido_fn = valido_escalar;
+#ifdef UTF8_X86
+    __builtin_cpu_init();
+    if (forzar && strcmp(forzar, "escalar") == 0) return;
+    if (__builtin_cpu_supports("avx2") && !(forzar && strcmp(forzar, "sse2") == 0))
+        valido_fn = valido_avx2;
+    else if (__builtin_cpu_supports("sse4.2"))
+        valido_fn = valido_sse42;
+#else
+    (void)forzar;
+#endif
+}
+
+void utf8_iniciar(Utf8Estado *st){
+    st->nresto = 0;
+    if (!valido_fn) elegir();
+}
+
+size_t utf8_validar(Utf8Estado *st, const char *buf, size_t n){
+    const unsigned char *s = (const unsigned char*)buf;
+    size_t i = 0;
+    if (!valido_fn) elegir();
+    if (st->nresto){
+        /* completar la secuencia que quedo cortada */
+        unsigned char tmp[4];
+        size_t k = st->nresto;
+        memcpy(tmp, st->resto, k);
+        while (k < 4 && i < n) tmp[k++] = s[i++];
+        int r = secuencia(tmp, k);
+        if (r == 0) return 0;
+        if (r < 0){
+            memcpy(st->resto, tmp, k);
+            st->nresto = (unsigned)k;
+            return n;
+        }
+        i = (size_t)r - st->nresto;
+        st->nresto = 0;
+    }
+    /* Una secuencia valida que empieza en los ultimos 3 bytes y no termina
+     * queda pendiente. Son solo continuaciones despues del primer byte:
+     * entre lo pendiente nunca hay un '\n'. */
+    size_t fin = n;
+    for (size_t k = 1; k <= 3 && k <= n - i; k++){
+        unsigned c = s[n - k];
+        if ((c & 0xC0) == 0x80) continue;
+        if (c >= 0xC0 && secuencia(s + n - k, k) < 0) fin = n - k;
+        break;
+    }
+    if (fin > i && !valido_fn(s + i, fin - i)) return i + primer_error(s + i, fin - i);
+    memcpy(st->resto, s + fin, n - fin);
+    st->nresto = (unsigned)(n - fin);
+    return n;
+}
+
+int utf8_terminar(const Utf8Estado *st){
+    return st->nresto == 0;
+}
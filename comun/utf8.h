@@ -0,0 +1,38 @@
+/* utf8.h - Validacion de UTF-8
+ *
+ * La entrada se valida por tramos, en el orden en que se lee: una
+ * secuencia cortada al final de un tramo queda pendiente para el
+ * siguiente. El grueso se valida de a 16 o 32 bytes (SSE4.2 o AVX2 segun
+ * la CPU, como indice.c) con el metodo de tablas de Keiser y Lemire, y
+ * los bloques solo ASCII cuestan una comparacion. La pasada escalar se
+ * usa solo para ubicar el byte de un error.
+ */
+#ifndef UTF8_H
+#define UTF8_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    unsigned char resto[4];   /* secuencia cortada al final del tramo anterior */
+    unsigned nresto;
+} Utf8Estado;
+
+void utf8_iniciar(Utf8Estado *st);
+
+/* Valida s[0..n) a continuacion de los tramos anteriores. Devuelve n si
+ * todo es valido, o la posicion del primer byte de la primera secuencia
+ * invalida (0 si es la que venia pendiente del tramo anterior). */
+size_t utf8_validar(Utf8Estado *st, const char *s, size_t n);
+
+/* Al final de la entrada: 0 si quedo una secuencia sin terminar */
+int utf8_terminar(const Utf8Estado *st);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
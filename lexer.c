@@ -1,87 +1,142 @@
 #include <stdio.h>
-#include <ctype.h>
 #include <string.h>
 #include "tokens.h"
+#include "comun/indice.h"
+#include "comun/lexico.h"
+#include "comun/estadisticas.h"
+#include "comun/flujo.h"
 
-// Función que reconoce el siguiente token en el archivo
+// El archivo se lee por bloques y cada bloque se clasifica una sola vez
+// (comun/indice.h, SIMD con respaldo escalar): los blancos se recorren
+// por mascaras de bits y las cadenas con lx_cadena_linea, no de a un fgetc.
+#define BLOQUE 65536
+
+static FILE *origen = NULL;
+static char bloque[BLOQUE];
+static IdxBloque mascaras[BLOQUE / IDX_BLOQUE];
+static size_t largo = 0, pos = 0;
+static uint64_t base = 0;        // posicion en el archivo de bloque[0]
+static uint64_t inicio = 0;      // del ultimo token reconocido
+static FlujoHuella *huella = NULL;   // con --tokens: cada bloque leido se suma
+
+static int rellenar(FILE *fuente) {
+    base += largo;
+    EST(est_entrar(EST_LEER));
+    largo = fread(bloque, 1, BLOQUE, fuente);
+    EST(est.bytes_entrada += largo; est_volver());
+    if (huella) flujo_huella_sumar(huella, bloque, largo);
+    pos = 0;
+    idx_clasificar(bloque, largo, mascaras);
+    return largo > 0;
+}
+
+static int leer(FILE *fuente) {
+    if (pos >= largo && !rellenar(fuente)) return EOF;
+    return (unsigned char)bloque[pos++];
+}
+
+// Equivale a ungetc: solo despues de un leer() que no dio EOF
+static void devolver(int c) {
+    if (c != EOF) pos--;
+}
+
+// Avanza sobre ' ', '\t' y '\r' dentro del bloque actual
+static void saltar_blancos(void) {
+    while (pos < largo) {
+        const IdxBloque *m = &mascaras[pos / IDX_BLOQUE];
+        uint64_t libres = ~(m->espacios & ~m->saltos) >> (pos % IDX_BLOQUE);
+        if (libres) {
+            pos += idx_ctz(libres);
+            if (pos > largo) pos = largo;
+            return;
+        }
+        pos = (pos / IDX_BLOQUE + 1) * IDX_BLOQUE;
+    }
+}
+
+// Agrega s[0..n) al lexema sin pasar de MAX_LEXEMA - 1 caracteres
+static void copiar(char *lexema, size_t *i, const char *s, size_t n) {
+    if (*i + n > MAX_LEXEMA - 1) n = *i < MAX_LEXEMA - 1 ? MAX_LEXEMA - 1 - *i : 0;
+    memcpy(lexema + *i, s, n);
+    *i += n;
+}
+
+// Función que reconoce el siguiente token en el archivo.
+// La clasificación y los escalares (números y palabras reservadas) salen
+// de las tablas del lexer comun (comun/lexico.h).
 TokenType reconocerToken(FILE *fuente, char *lexema) {
-    int c;
+    int c, clase;
+
+    if (fuente != origen) {
+        origen = fuente;
+        largo = pos = 0;
+        base = 0;
+    }
 
     // Ignorar espacios en blanco excepto saltos de línea
-    do {
-        c = fgetc(fuente);
-        if (c == '\n') return NEWLINE;  
-    } while (isspace(c));
-
-    // Fin de archivo
-    if (c == EOF) return EOF_TOKEN;
-
-    // Signos de puntuación
-    if (c == '{') return L_LLAVE;
-    if (c == '}') return R_LLAVE;
-    if (c == '[') return L_CORCHETE;
-    if (c == ']') return R_CORCHETE;
-    if (c == ',') return COMA;
-    if (c == ':') return DOS_PUNTOS;
-
-    // Números
-    if (isdigit(c)) {
-        int i = 0;
-        lexema[i++] = c;
-        while (isdigit(c = fgetc(fuente))) {
-            lexema[i++] = c;
-        }
-        if (c == '.') { // decimal
-            lexema[i++] = c;
-            while (isdigit(c = fgetc(fuente))) {
-                lexema[i++] = c;
-            }
-        }
-        if (c == 'e' || c == 'E') { // notación científica
-            lexema[i++] = c;
-            c = fgetc(fuente);
-            if (c == '+' || c == '-') {
-                lexema[i++] = c;
-                c = fgetc(fuente);
-            }
-            while (isdigit(c)) {
-                lexema[i++] = c;
-                c = fgetc(fuente);
-            }
-        }
-        lexema[i] = '\0';
-        ungetc(c, fuente); // devolver último caracter no numérico
-        return LITERAL_NUM;
+    for (;;) {
+        saltar_blancos();
+        c = leer(fuente);
+        inicio = base + pos - 1;
+        if (c == EOF) { inicio = base + pos; return EOF_TOKEN; }  // Fin de archivo
+        clase = lx_clase[c];
+        if (clase == LXC_SALTO) return NEWLINE;
+        if (clase != LXC_BLANCO) break;
     }
 
-    // Literales en cadena
-    if (c == '"') {
-        int i = 0;
-        while ((c = fgetc(fuente)) != '"' && c != EOF) {
-            lexema[i++] = c;
+    // Signos de puntuación: la clase es el tipo de token
+    if (clase <= LXC_DOS_PUNTOS) return (TokenType)clase;
+
+    size_t i = 0;
+
+    // Literales en cadena, con la regla de comun/lexico.h: terminan en la
+    // comilla o antes del fin de la línea (el '\n', escapado o no, queda
+    // para el NEWLINE siguiente); una barra invertida escapa el caracter
+    // siguiente
+    if (clase == LXC_COMILLA) {
+        for (;;) {
+            size_t fin = pos + lx_cadena_linea(bloque + pos, largo - pos);
+            copiar(lexema, &i, bloque + pos, fin - pos);
+            pos = fin;
+            if (pos == largo) {
+                if (!rellenar(fuente)) break;    // EOF dentro de la cadena
+                continue;
+            }
+            if (bloque[pos] == '\n') break;      // fin de la línea
+            if (bloque[pos++] == '"') break;     // comilla de cierre
+            char esc[2] = { '\\', 0 };
+            c = leer(fuente);
+            if (c == EOF || c == '\n') { devolver(c); copiar(lexema, &i, esc, 1); break; }
+            esc[1] = (char)c;
+            copiar(lexema, &i, esc, 2);
         }
         lexema[i] = '\0';
         return LITERAL_CADENA;
     }
 
-    // Palabras reservadas: true, false, null
-    if (isalpha(c)) {
-        char buffer[20];
-        int i = 0;
-        buffer[i++] = c;
-        while (isalpha(c = fgetc(fuente))) {
-            buffer[i++] = c;
-        }
-        buffer[i] = '\0';
-        ungetc(c, fuente); // devolvemos el último no-alfabético
-
-        if (strcasecmp(buffer, "true") == 0) return PR_TRUE;
-        if (strcasecmp(buffer, "false") == 0) return PR_FALSE;
-        if (strcasecmp(buffer, "null") == 0) return PR_NULL;
-
-        return ERROR_TOKEN;
+    // Números, palabras reservadas (true, false, null) y errores: la
+    // corrida hasta el próximo delimitador pasa por el autómata comun
+    unsigned char estado = LXA_INICIO;
+    devolver(c);
+    for (;;) {
+        size_t n = lx_escalar(&estado, bloque + pos, largo - pos);
+        copiar(lexema, &i, bloque + pos, n);
+        pos += n;
+        if (pos < largo || !rellenar(fuente)) break;
     }
+    lexema[i] = '\0';
+    return (TokenType)lx_fin_escalar(estado, lexema, i);
+}
 
-    return ERROR_TOKEN;
+// Donde estaba en el archivo el ultimo token reconocido: [*ini, *fin).
+// Despues de EOF_TOKEN los dos son el largo del archivo.
+void posicionToken(uint64_t *ini, uint64_t *fin) {
+    *ini = inicio;
+    *fin = base + pos;
 }
 
+// Desde el proximo bloque, suma a h todo lo que se lee de la fuente: la
+// huella de lo que se analizo, para la cabecera de --tokens (comun/flujo.h)
+void huellaFuente(FlujoHuella *h) {
+    huella = h;
+}
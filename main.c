@@ -1,21 +1,79 @@
 #include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 #include "tokens.h"
+#include "comun/estadisticas.h"
+#include "comun/flujo.h"
 
-// Prototipo de la función del lexer
+// Prototipos de las funciones del lexer
 TokenType reconocerToken(FILE *fuente, char *lexema);
+void posicionToken(uint64_t *ini, uint64_t *fin);
+void huellaFuente(FlujoHuella *h);
 
-int main() {
-    FILE *fuente = fopen("fuente.txt", "r");
-    FILE *salida = fopen("output.txt", "w");
-    char lexema[256];
+// --stats: el lexer no arma arbol, la profundidad es la de llaves y corchetes
+static inline void contar(TokenType t) {
+    static size_t prof = 0;
+    est_token(t);
+    if (t == L_LLAVE || t == L_CORCHETE) est_profundidad(++prof);
+    else if ((t == R_LLAVE || t == R_CORCHETE) && prof) prof--;
+}
+
+// Uso: lexer [--stats] [--tokens [--tabla]] [entrada [salida]]
+//          (por defecto fuente.txt y output.txt)
+//   --stats   tiempos por fase, tokens por tipo, profundidad y bytes en JSON
+//             por stderr (comun/estadisticas.h)
+//   --tokens  ademas escribe entrada.tok, los tokens en binario con su
+//             posicion en la fuente y una huella de ella (comun/flujo.h);
+//             el analizador sintactico lo usa con --tokens entrada.tok en
+//             vez de volver a analizar el texto
+//   --tabla   con --tokens, guarda tambien los lexemas
+int main(int argc, char *argv[]) {
+    const char *rutas[2] = { "fuente.txt", "output.txt" };
+    int nrutas = 0, stats = 0, binario = 0, tabla = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) stats = 1;
+        else if (strcmp(argv[i], "--tokens") == 0) binario = 1;
+        else if (strcmp(argv[i], "--tabla") == 0) tabla = 1;
+        else if (nrutas < 2) rutas[nrutas++] = argv[i];
+    }
+    // En binario: las posiciones de --tokens son bytes del archivo (los
+    // '\r' son blancos para el lexer, asi que la salida de texto no cambia)
+    FILE *fuente = fopen(rutas[0], "rb");
+    FILE *salida = fopen(rutas[1], "w");
+    char lexema[MAX_LEXEMA];
     TokenType token;
+    FlujoEscritor flujo;
+    FlujoHuella huella;
+    char *ruta_flujo = NULL;
 
     if (!fuente || !salida) {
         printf("Error al abrir archivos.\n");
         return 1;
     }
+    if (binario) {
+        size_t n = strlen(rutas[0]);
+        ruta_flujo = (char*)malloc(n + 5);
+        if (!ruta_flujo) return 1;
+        memcpy(ruta_flujo, rutas[0], n);
+        memcpy(ruta_flujo + n, ".tok", 5);
+        if (!flujo_crear(&flujo, ruta_flujo, tabla ? FLUJO_TABLA : 0)) {
+            printf("Error al crear %s.\n", ruta_flujo);
+            return 1;
+        }
+        flujo_huella_iniciar(&huella);
+        huellaFuente(&huella);
+    }
+    if (stats && !EST_DISPONIBLE) fprintf(stderr, "Aviso: --stats no disponible (compilado con -DSIN_STATS)\n");
+    if (stats && EST_DISPONIBLE) est_iniciar("lexer", rutas[0], EST_LEXICO);
 
     while ((token = reconocerToken(fuente, lexema)) != EOF_TOKEN) {
+        EST(est_fase(EST_SALIDA); contar(token));
+        if (binario) {
+            uint64_t ini, fin;
+            posicionToken(&ini, &fin);
+            flujo_escribir(&flujo, token == NEWLINE ? FLUJO_SALTO : (int)token, ini, fin - ini,
+                           lexema, flujo_con_lexema(token) ? strlen(lexema) : 0);
+        }
         switch (token) {
             case L_LLAVE: fprintf(salida, "L_LLAVE "); break;
             case R_LLAVE: fprintf(salida, "R_LLAVE "); break;
@@ -32,10 +90,24 @@ int main() {
             case ERROR_TOKEN: fprintf(salida, "ERROR "); break;
             default: break;
         }
+        EST(est_fase(EST_LEXICO));
     }
 
     fclose(fuente);
+    EST(est_fase(EST_SALIDA));
+    if (binario) {
+        uint64_t ini, fin;
+        posicionToken(&ini, &fin);
+        if (!flujo_terminar(&flujo, fin, flujo_huella_fin(&huella))) {
+            printf("Error al escribir %s.\n", ruta_flujo);
+            remove(ruta_flujo);
+        }
+        free(ruta_flujo);
+    }
+    fflush(salida);
+    EST(long n = ftell(salida); if (n > 0) est.bytes_salida = (unsigned long long)n);
     fclose(salida);
+    EST(est_reportar(stderr));
     return 0;
 }
 
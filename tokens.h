@@ -1,22 +1,28 @@
 #ifndef TOKENS_H
 #define TOKENS_H
 
-// Definición de todos los tipos de tokens válidos
+#include "comun/lexico.h"
+
+// Tamaño del buffer de lexema de reconocerToken (los más largos se truncan)
+#define MAX_LEXEMA 256
+
+// Definición de todos los tipos de tokens válidos. Los valores son los
+// del lexer comun (comun/lexico.h), asi su resultado se usa sin traducir.
 typedef enum {
-    L_CORCHETE,     // [
-    R_CORCHETE,     // ]
-    L_LLAVE,        // {
-    R_LLAVE,        // }
-    COMA,           // ,
-    DOS_PUNTOS,     // :
-    LITERAL_CADENA, // "texto"
-    LITERAL_NUM,    // 123, 3.14, 2e10
-    PR_TRUE,        // true / TRUE
-    PR_FALSE,       // false / FALSE
-    PR_NULL,        // null / NULL
-    EOF_TOKEN,      // Fin de archivo
-    NEWLINE,        // salto de linea
-    ERROR_TOKEN     // Token no válido
+    L_CORCHETE = LX_CORCHETE_A,     // [
+    R_CORCHETE = LX_CORCHETE_C,     // ]
+    L_LLAVE = LX_LLAVE_A,           // {
+    R_LLAVE = LX_LLAVE_C,           // }
+    COMA = LX_COMA,                 // ,
+    DOS_PUNTOS = LX_DOS_PUNTOS,     // :
+    LITERAL_CADENA = LX_CADENA,     // "texto"
+    LITERAL_NUM = LX_NUMERO,        // 123, -3.14, 2e10
+    PR_TRUE = LX_TRUE,              // true / TRUE
+    PR_FALSE = LX_FALSE,            // false / FALSE
+    PR_NULL = LX_NULL,              // null / NULL
+    EOF_TOKEN = LX_FIN,             // Fin de archivo
+    NEWLINE = LX_ERROR + 1,         // salto de linea
+    ERROR_TOKEN = LX_ERROR          // Token no válido
 } TokenType;
 
 #endif